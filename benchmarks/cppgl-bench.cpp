@@ -0,0 +1,831 @@
+#include "CppGL/api.h"
+#include "CppGL/constant.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#define TINYGLTF_NOEXCEPTION
+#define JSON_NOEXCEPTION
+#include <tiny_gltf.h>
+
+/**
+ * @brief 无窗口的场景基准测试, 每个场景在指定的分辨率和线程数下
+ * 先预热再渲染固定帧数, 结果以 JSON 输出到 stdout
+ *
+ * cppgl-bench [--frames N] [--warmup N] [--resolutions 320x240,640x480]
+ *             [--threads 1,4] [--affinity 0,2,4,6] [--numa 1]
+ *             [--scenarios fill-rate,gltf-cube]
+ *             [--models ../models] [--trace trace.json] [--perf 1]
+ *
+ * --threads 逐个传给 Jobs::setThreadCount
+ * --affinity 为 worker 线程绑定的 cpu, 见 Jobs::setAffinity
+ * --numa 按 NUMA 节点绑定 worker 并固定 tile 行的归属, 见 Jobs::setNumaAffinity
+ *
+ * --trace 需在 CPPGL_ENABLE_TRACE 打开时构建, 记录整个运行过程
+ * --perf 输出各阶段每帧平均的硬件计数器读数, 只在 Linux 上可用
+ */
+
+using namespace CppGL;
+using namespace rttr;
+
+const int GLTF_UNSIGNED_INT = 5125;
+const int GLTF_UNSIGNED_SHORT = 5123;
+const int GLTF_UNSIGNED_BYTE = 5121;
+const int GLTF_SHORT = 5122;
+const int GLTF_BYTE = 5120;
+const int GLTF_FLOAT = 5126;
+
+#include "CppGL/marco.h" // 必须在所有include后面
+
+static struct FlatVertexShaderSource : ShaderSource {
+  attribute vec4 position;
+  uniform vec4 color;
+  varying vec4 v_color;
+
+  void main() {
+    gl_Position = position;
+    v_color = color;
+  }
+
+  RTTR_ENABLE(ShaderSource)
+} flatVertexShaderSource;
+
+static struct FlatFragmentShaderSource : ShaderSource {
+  varying vec4 v_color;
+
+  void main() {
+    gl_FragColor = v_color;
+  }
+
+  RTTR_ENABLE(ShaderSource)
+} flatFragmentShaderSource;
+
+static struct TextureVertexShaderSource : ShaderSource {
+  attribute vec4 position;
+  attribute vec2 texcoord;
+  uniform vec2 uvScale;
+  varying vec2 v_texcoord;
+
+  void main() {
+    gl_Position = position;
+    v_texcoord = texcoord * uvScale;
+  }
+
+  RTTR_ENABLE(ShaderSource)
+} textureVertexShaderSource;
+
+static struct TextureFragmentShaderSource : ShaderSource {
+  varying vec2 v_texcoord;
+  uniform sampler2D map;
+
+  void main() {
+    gl_FragColor = texture2D(map, v_texcoord);
+  }
+
+  RTTR_ENABLE(ShaderSource)
+} textureFragmentShaderSource;
+
+// 与 examples/draw-gltf.cpp 相同的光照模型
+static struct GltfVertexShaderSource : ShaderSource {
+  attribute vec4 position;
+  attribute vec3 normal;
+  attribute vec2 texcoord;
+
+  uniform mat4 projection;
+  uniform mat4 modelView;
+  uniform mat4 modelToWorld;
+
+  varying vec3 v_normal;
+  varying vec2 v_texcoord;
+  varying vec3 v_position;
+
+  void main() {
+    gl_Position = projection * modelView * position;
+    v_position = vec3(modelToWorld * position);
+    v_normal = mat3(modelView) * normal;
+    v_texcoord = texcoord;
+  }
+
+  RTTR_ENABLE(ShaderSource)
+} gltfVertexShaderSource;
+
+static struct GltfFragmentShaderSource : ShaderSource {
+  varying vec3 v_normal;
+  varying vec2 v_texcoord;
+  varying vec3 v_position;
+
+  uniform sampler2D diffuse;
+  uniform vec3 lightColor;
+  uniform vec3 lightDirection;
+  uniform vec3 pointLightPosition;
+  uniform vec3 cameraPosition;
+
+  void main() {
+    vec3 normal = normalize(v_normal);
+    vec4 baseColor = texture2D(diffuse, v_texcoord);
+    vec3 pointLightDirection = pointLightPosition - v_position;
+    vec3 viewDirection = normalize(cameraPosition - v_position);
+    vec3 halfAngle = normalize(lightDirection + viewDirection);
+
+    float diffuseFactor = max(dot(normal, lightDirection), 0) +
+                          max(dot(normal, pointLightDirection), 0);
+    float specular = pow(max(dot(viewDirection, halfAngle), 0), 128);
+    vec3 light = lightColor * (0.3f + 0.3f * diffuseFactor + 0.3f * specular);
+    gl_FragColor = vec4(vec3(baseColor) * light, baseColor.a);
+  }
+
+  RTTR_ENABLE(ShaderSource)
+} gltfFragmentShaderSource;
+
+CPPGL_RTTR_REGISTRATION {
+  using S = FlatVertexShaderSource;
+  using M = ShaderSourceMeta;
+  registration::class_<S>("FlatVertexShaderSource")
+      .CPPGL_RTTR_PROP(position, M::Attribute)
+      .CPPGL_RTTR_PROP(color, M::Uniform)
+      .CPPGL_RTTR_PROP(v_color, M::Varying)
+      .method("main", &S::main);
+}
+
+CPPGL_RTTR_REGISTRATION {
+  using S = FlatFragmentShaderSource;
+  using M = ShaderSourceMeta;
+  registration::class_<S>("FlatFragmentShaderSource")
+      .CPPGL_RTTR_PROP(v_color, M::Varying)
+      .method("main", &S::main);
+}
+
+CPPGL_RTTR_REGISTRATION {
+  using S = TextureVertexShaderSource;
+  using M = ShaderSourceMeta;
+  registration::class_<S>("TextureVertexShaderSource")
+      .CPPGL_RTTR_PROP(position, M::Attribute)
+      .CPPGL_RTTR_PROP(texcoord, M::Attribute)
+      .CPPGL_RTTR_PROP(uvScale, M::Uniform)
+      .CPPGL_RTTR_PROP(v_texcoord, M::Varying)
+      .method("main", &S::main);
+}
+
+CPPGL_RTTR_REGISTRATION {
+  using S = TextureFragmentShaderSource;
+  using M = ShaderSourceMeta;
+  registration::class_<S>("TextureFragmentShaderSource")
+      .CPPGL_RTTR_PROP(v_texcoord, M::Varying)
+      .CPPGL_RTTR_PROP(map, M::Uniform)
+      .method("main", &S::main);
+}
+
+CPPGL_RTTR_REGISTRATION {
+  using S = GltfVertexShaderSource;
+  using M = ShaderSourceMeta;
+  registration::class_<S>("GltfVertexShaderSource")
+      .CPPGL_RTTR_PROP(position, M::Attribute)
+      .CPPGL_RTTR_PROP(normal, M::Attribute)
+      .CPPGL_RTTR_PROP(texcoord, M::Attribute)
+      .CPPGL_RTTR_PROP(projection, M::Uniform)
+      .CPPGL_RTTR_PROP(modelView, M::Uniform)
+      .CPPGL_RTTR_PROP(modelToWorld, M::Uniform)
+      .CPPGL_RTTR_PROP(v_normal, M::Varying)
+      .CPPGL_RTTR_PROP(v_texcoord, M::Varying)
+      .CPPGL_RTTR_PROP(v_position, M::Varying)
+      .method("main", &S::main);
+}
+
+CPPGL_RTTR_REGISTRATION {
+  using S = GltfFragmentShaderSource;
+  using M = ShaderSourceMeta;
+  registration::class_<S>("GltfFragmentShaderSource")
+      .CPPGL_RTTR_PROP(v_normal, M::Varying)
+      .CPPGL_RTTR_PROP(v_texcoord, M::Varying)
+      .CPPGL_RTTR_PROP(v_position, M::Varying)
+      .CPPGL_RTTR_PROP(diffuse, M::Uniform)
+      .CPPGL_RTTR_PROP(lightColor, M::Uniform)
+      .CPPGL_RTTR_PROP(lightDirection, M::Uniform)
+      .CPPGL_RTTR_PROP(pointLightPosition, M::Uniform)
+      .CPPGL_RTTR_PROP(cameraPosition, M::Uniform)
+      .method("main", &S::main);
+}
+
+Program *createProgram(ShaderSource *vertexSource,
+                       ShaderSource *fragmentSource) {
+  auto vertexShader = glCreateShader(GL_VERTEX_SHADER);
+  glShaderSource(vertexShader, vertexSource);
+  glCompileShader(vertexShader);
+  auto fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+  glShaderSource(fragmentShader, fragmentSource);
+  glCompileShader(fragmentShader);
+  auto program = glCreateProgram();
+  glAttachShader(program, vertexShader);
+  glAttachShader(program, fragmentShader);
+  glLinkProgram(program);
+  return program;
+}
+
+/**
+ * @brief 一个场景, setup 在每个分辨率开始时调用一次,
+ * frame 绘制一帧并返回提交的三角形数
+ */
+struct Scenario {
+  std::string name;
+  std::function<bool(int width, int height)> setup;
+  std::function<long long()> frame;
+};
+
+struct Options {
+  int frames = 20;
+  int warmup = 2;
+  std::vector<std::pair<int, int>> resolutions{
+      {320, 240}, {640, 480}, {1280, 720}};
+  std::vector<int> threads;
+  std::vector<int> affinity;
+  bool numa = false;
+  std::vector<std::string> scenarios;
+  std::string models = "../models";
+  std::string trace{};
+  bool perf = false;
+};
+
+std::vector<std::string> split(const std::string &value) {
+  std::vector<std::string> parts;
+  size_t begin = 0;
+  while (begin <= value.size()) {
+    size_t end = value.find(',', begin);
+    if (end == std::string::npos)
+      end = value.size();
+    if (end > begin)
+      parts.push_back(value.substr(begin, end - begin));
+    begin = end + 1;
+  }
+  return parts;
+}
+
+bool parseOptions(int argc, char **argv, Options &options) {
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string key = argv[i];
+    std::string value = argv[i + 1];
+    if (key == "--frames") {
+      options.frames = std::max(std::stoi(value), 1);
+    } else if (key == "--warmup") {
+      options.warmup = std::max(std::stoi(value), 0);
+    } else if (key == "--resolutions") {
+      options.resolutions.clear();
+      for (auto &part : split(value)) {
+        int width = 0, height = 0;
+        if (sscanf(part.c_str(), "%dx%d", &width, &height) == 2 &&
+            width > 0 && height > 0)
+          options.resolutions.push_back({width, height});
+      }
+    } else if (key == "--threads") {
+      options.threads.clear();
+      for (auto &part : split(value))
+        options.threads.push_back(std::max(std::stoi(part), 1));
+    } else if (key == "--affinity") {
+      options.affinity.clear();
+      for (auto &part : split(value))
+        options.affinity.push_back(std::stoi(part));
+    } else if (key == "--numa") {
+      options.numa = value != "0";
+    } else if (key == "--scenarios") {
+      options.scenarios = split(value);
+    } else if (key == "--models") {
+      options.models = value;
+    } else if (key == "--trace") {
+      options.trace = value;
+    } else if (key == "--perf") {
+      options.perf = value != "0";
+    } else {
+      fprintf(stderr, "unknown option %s\n", key.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+void printPerf(const PerfFrame &frame, int frames) {
+  const char *names[] = {"vertex", "raster", "fragment"};
+  printf(", \"perf\": {");
+  for (int i = 0; i < (int)PerfStage::COUNT; i++) {
+    auto &values = frame.stages[i];
+    printf("%s\"%s\": {\"cycles\": %.1f, \"instructions\": %.1f, "
+           "\"l1dMisses\": %.1f, \"llcMisses\": %.1f, "
+           "\"branchMisses\": %.1f}",
+           i == 0 ? "" : ", ", names[i], (double)values.cycles / frames,
+           (double)values.instructions / frames,
+           (double)values.l1dMisses / frames,
+           (double)values.llcMisses / frames,
+           (double)values.branchMisses / frames);
+  }
+  printf("}");
+}
+
+/**
+ * @brief 每个分辨率一个 framebuffer, 颜色 GL_RGBA8 深度 GL_DEPTH_COMPONENT32F
+ */
+FrameBuffer *createFramebuffer(int width, int height) {
+  auto framebuffer = glCreateFramebuffer();
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  auto color = glCreateRenderbuffer();
+  glBindRenderbuffer(GL_RENDERBUFFER, color);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, color);
+  auto depth = glCreateRenderbuffer();
+  glBindRenderbuffer(GL_RENDERBUFFER, depth);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, width, height);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                            GL_RENDERBUFFER, depth);
+  glViewport(0, 0, width, height);
+  return framebuffer;
+}
+
+void deleteFramebuffer(FrameBuffer *framebuffer) {
+  for (auto attachment :
+       {framebuffer->COLOR_ATTACHMENT0, framebuffer->DEPTH_ATTACHMENT}) {
+    if (attachment.attachment == nullptr)
+      continue;
+    for (auto mip : attachment.attachment->mips) {
+      free(const_cast<void *>(mip->data));
+      delete mip;
+    }
+    delete attachment.attachment;
+  }
+  delete framebuffer;
+}
+
+/**
+ * @brief 覆盖 [x0, x1] x [y0, y1] 的两个三角形, 带 uv
+ */
+void pushQuad(std::vector<float> &data, float x0, float y0, float x1, float y1,
+              float z) {
+  const float corners[6][4] = {{x0, y0, 0, 0}, {x1, y0, 1, 0},
+                               {x1, y1, 1, 1}, {x0, y0, 0, 0},
+                               {x1, y1, 1, 1}, {x0, y1, 0, 1}};
+  for (auto &corner : corners)
+    data.insert(data.end(), {corner[0], corner[1], z, corner[2], corner[3]});
+}
+
+/**
+ * @brief 顶点布局为 position(3) + texcoord(2)
+ */
+VertexArray *createQuadVertexArray(const std::vector<float> &data,
+                                   int positionLocation,
+                                   int texcoordLocation) {
+  auto vao = glCreateVertexArray();
+  glBindVertexArray(vao);
+  auto buffer = glCreateBuffer();
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), data.data(),
+               GL_STATIC_DRAW);
+  int stride = 5 * sizeof(float);
+  glEnableVertexAttribArray(positionLocation);
+  glVertexAttribPointer(positionLocation, 3, GL_FLOAT, false, stride, 0);
+  if (texcoordLocation >= 0) {
+    glEnableVertexAttribArray(texcoordLocation);
+    glVertexAttribPointer(texcoordLocation, 2, GL_FLOAT, false, stride,
+                          3 * sizeof(float));
+  }
+  glBindVertexArray(nullptr);
+  return vao;
+}
+
+std::vector<Scenario> createQuadScenarios() {
+  std::vector<Scenario> scenarios;
+  Program *flatProgram =
+      createProgram(&flatVertexShaderSource, &flatFragmentShaderSource);
+  Program *textureProgram =
+      createProgram(&textureVertexShaderSource, &textureFragmentShaderSource);
+  const int flatPosition = glGetAttribLocation(flatProgram, "position");
+  const int flatColor = glGetUniformLocation(flatProgram, "color");
+
+  // 填充率: 不开深度测试, 每帧4层全屏
+  {
+    const int layers = 4;
+    std::vector<float> data;
+    for (int i = 0; i < layers; i++)
+      pushQuad(data, -1, -1, 1, 1, 0);
+    auto vao = createQuadVertexArray(data, flatPosition, -1);
+    scenarios.push_back(
+        {"fill-rate", [](int, int) { return true; },
+         [=]() {
+           glUseProgram(flatProgram);
+           glBindVertexArray(vao);
+           glDisable(GL_DEPTH_TEST);
+           vec4 color{0.2, 0.4, 0.6, 1};
+           glUniform4fv(flatColor, 1, &color);
+           glDrawArrays(GL_TRIANGLES, 0, layers * 6);
+           return (long long)layers * 2;
+         }});
+  }
+
+  // 三角形速率: 4x4 像素的格子, 每格两个三角形, 随分辨率重新生成
+  {
+    auto vao = std::make_shared<VertexArray *>(nullptr);
+    auto count = std::make_shared<int>(0);
+    scenarios.push_back(
+        {"triangle-rate",
+         [=](int width, int height) {
+           const int cell = 4;
+           std::vector<float> data;
+           for (int y = 0; y + cell <= height; y += cell)
+             for (int x = 0; x + cell <= width; x += cell)
+               pushQuad(data, 2.f * x / width - 1, 2.f * y / height - 1,
+                        2.f * (x + cell) / width - 1,
+                        2.f * (y + cell) / height - 1, 0);
+           *vao = createQuadVertexArray(data, flatPosition, -1);
+           *count = data.size() / 5;
+           return true;
+         },
+         [=]() {
+           glUseProgram(flatProgram);
+           glBindVertexArray(*vao);
+           glDisable(GL_DEPTH_TEST);
+           vec4 color{0.6, 0.4, 0.2, 1};
+           glUniform4fv(flatColor, 1, &color);
+           glDrawArrays(GL_TRIANGLES, 0, *count);
+           return (long long)*count / 3;
+         }});
+  }
+
+  // overdraw: 16层全屏开深度测试, 由远到近每层都通过, 由近到远只有第一层通过
+  for (bool backToFront : {true, false}) {
+    const int layers = 16;
+    std::vector<float> data;
+    for (int i = 0; i < layers; i++) {
+      float z = 0.9f - 1.8f * i / (layers - 1);
+      pushQuad(data, -1, -1, 1, 1, backToFront ? z : -z);
+    }
+    auto vao = createQuadVertexArray(data, flatPosition, -1);
+    scenarios.push_back(
+        {backToFront ? "overdraw-back-to-front" : "overdraw-front-to-back",
+         [](int, int) { return true; },
+         [=]() {
+           glUseProgram(flatProgram);
+           glBindVertexArray(vao);
+           glEnable(GL_DEPTH_TEST);
+           vec4 color{0.3, 0.3, 0.3, 1};
+           glUniform4fv(flatColor, 1, &color);
+           glDrawArrays(GL_TRIANGLES, 0, layers * 6);
+           return (long long)layers * 2;
+         }});
+  }
+
+  // 纹理: 1024x1024 RGBA 纹理, 每帧4层全屏, uv 重复4次
+  {
+    const int layers = 4;
+    const int size = 1024;
+    // glTexImage2D 不拷贝数据, 像素由场景持有
+    auto pixels = std::make_shared<std::vector<uint8_t>>(size * size * 4);
+    for (int i = 0; i < size * size; i++) {
+      // 固定的哈希生成纹理, 结果可复现
+      uint32_t h = i * 2654435761u;
+      (*pixels)[i * 4] = h >> 24;
+      (*pixels)[i * 4 + 1] = h >> 16;
+      (*pixels)[i * 4 + 2] = h >> 8;
+      (*pixels)[i * 4 + 3] = 255;
+    }
+    auto texture = glCreateTexture();
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, pixels->data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    std::vector<float> data;
+    for (int i = 0; i < layers; i++)
+      pushQuad(data, -1, -1, 1, 1, 0);
+    auto vao = createQuadVertexArray(
+        data, glGetAttribLocation(textureProgram, "position"),
+        glGetAttribLocation(textureProgram, "texcoord"));
+    const int uvScaleLoc = glGetUniformLocation(textureProgram, "uvScale");
+    const int mapLoc = glGetUniformLocation(textureProgram, "map");
+    scenarios.push_back({"texture-heavy", [](int, int) { return true; },
+                         [=]() {
+                           (void)pixels;
+                           glUseProgram(textureProgram);
+                           glBindVertexArray(vao);
+                           glDisable(GL_DEPTH_TEST);
+                           glActiveTexture(GL_TEXTURE0);
+                           glBindTexture(GL_TEXTURE_2D, texture);
+                           glUniform1i(mapLoc, 0);
+                           vec2 uvScale{4, 4};
+                           glUniform2fv(uvScaleLoc, 1, &uvScale);
+                           glDrawArrays(GL_TRIANGLES, 0, layers * 6);
+                           return (long long)layers * 2;
+                         }});
+  }
+  return scenarios;
+}
+
+/**
+ * @brief glTF 模型, 资源在第一次 setup 时上传, 每帧绕 y 轴转固定角度
+ */
+struct GltfScene {
+  tinygltf::Model model;
+  std::string baseDir;
+  Program *program = nullptr;
+  std::unordered_map<int, Buffer *> buffers;
+  std::unordered_map<int, Texture *> textures;
+  std::unordered_map<const tinygltf::Primitive *, VertexArray *> vaos;
+  mat4 modelWorldMatrix;
+  float aspect = 1;
+  bool loaded = false;
+
+  bool load(const std::string &filename) {
+    tinygltf::TinyGLTF loader;
+    std::string err, warn;
+    if (!loader.LoadASCIIFromFile(&model, &err, &warn, filename)) {
+      fprintf(stderr, "failed to load glTF %s: %s\n", filename.c_str(),
+              err.c_str());
+      return false;
+    }
+    baseDir = filename.substr(0, filename.find_last_of("/\\") + 1);
+    program = createProgram(&gltfVertexShaderSource, &gltfFragmentShaderSource);
+    loaded = true;
+    return true;
+  }
+
+  static int componentType(int gltfType) {
+    switch (gltfType) {
+    case GLTF_FLOAT:
+      return GL_FLOAT;
+    case GLTF_UNSIGNED_BYTE:
+      return GL_UNSIGNED_BYTE;
+    case GLTF_UNSIGNED_SHORT:
+      return GL_UNSIGNED_SHORT;
+    case GLTF_UNSIGNED_INT:
+      return GL_UNSIGNED_INT;
+    case GLTF_BYTE:
+      return GL_BYTE;
+    case GLTF_SHORT:
+      return GL_SHORT;
+    }
+    return 0;
+  }
+
+  void uploadBuffer(int bufferViewIndex, int target) {
+    auto search = buffers.find(bufferViewIndex);
+    if (search != buffers.end()) {
+      glBindBuffer(target, search->second);
+      return;
+    }
+    auto &bufferView = model.bufferViews[bufferViewIndex];
+    auto &buffer = model.buffers[bufferView.buffer];
+    auto glBuffer = glCreateBuffer();
+    buffers.emplace(bufferViewIndex, glBuffer);
+    glBindBuffer(target, glBuffer);
+    glBufferData(target, bufferView.byteLength,
+                 buffer.data.data() + bufferView.byteOffset, GL_STATIC_DRAW);
+  }
+
+  void uploadAttribute(int accessorIndex, int location) {
+    if (accessorIndex < 0 || location < 0)
+      return;
+    auto &accessor = model.accessors[accessorIndex];
+    auto &bufferView = model.bufferViews[accessor.bufferView];
+    uploadBuffer(accessor.bufferView, GL_ARRAY_BUFFER);
+    int size = accessor.type == TINYGLTF_TYPE_SCALAR ? 1 : accessor.type;
+    glEnableVertexAttribArray(location);
+    glVertexAttribPointer(location, size, componentType(accessor.componentType),
+                          accessor.normalized, accessor.ByteStride(bufferView),
+                          accessor.byteOffset);
+  }
+
+  Texture *uploadTexture(int textureIndex) {
+    if (textureIndex < 0)
+      return nullptr;
+    auto search = textures.find(textureIndex);
+    if (search != textures.end())
+      return search->second;
+    auto &image = model.images[model.textures[textureIndex].source];
+    auto texture = glCreateTexture();
+    textures.emplace(textureIndex, texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width, image.height, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, image.image.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    return texture;
+  }
+
+  long long renderMesh(int meshIndex, const mat4 &worldMatrix) {
+    long long triangles = 0;
+    glUniformMatrix4fv(glGetUniformLocation(program, "modelView"), 1, false,
+                       &worldMatrix);
+    glUniformMatrix4fv(glGetUniformLocation(program, "modelToWorld"), 1, false,
+                       &worldMatrix);
+    for (auto &primitive : model.meshes[meshIndex].primitives) {
+      if (primitive.indices < 0)
+        continue;
+      auto &indices = model.accessors[primitive.indices];
+      auto search = vaos.find(&primitive);
+      if (search != vaos.end()) {
+        glBindVertexArray(search->second);
+      } else {
+        auto vao = glCreateVertexArray();
+        vaos.emplace(&primitive, vao);
+        glBindVertexArray(vao);
+        uploadBuffer(indices.bufferView, GL_ELEMENT_ARRAY_BUFFER);
+        auto accessorOf = [&](const char *name) {
+          auto found = primitive.attributes.find(name);
+          return found == primitive.attributes.end() ? -1 : found->second;
+        };
+        uploadAttribute(accessorOf("POSITION"),
+                        glGetAttribLocation(program, "position"));
+        uploadAttribute(accessorOf("TEXCOORD_0"),
+                        glGetAttribLocation(program, "texcoord"));
+        uploadAttribute(accessorOf("NORMAL"),
+                        glGetAttribLocation(program, "normal"));
+      }
+
+      if (primitive.material >= 0) {
+        auto &material = model.materials[primitive.material];
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D,
+                      uploadTexture(
+                          material.pbrMetallicRoughness.baseColorTexture.index));
+        glUniform1i(glGetUniformLocation(program, "diffuse"), 0);
+      }
+      // 绑定 element buffer 时 indices 参数仍按指针处理
+      const void *indicesPtr = nullptr;
+      if (indices.byteOffset != 0)
+        indicesPtr = static_cast<const uint8_t *>(
+                         buffers[indices.bufferView]->data) +
+                     indices.byteOffset;
+      glDrawElements(GL_TRIANGLES, indices.count,
+                     componentType(indices.componentType), indicesPtr);
+      triangles += indices.count / 3;
+    }
+    glBindVertexArray(nullptr);
+    return triangles;
+  }
+
+  long long renderNode(int nodeIndex, const mat4 &parentMatrix) {
+    auto &node = model.nodes[nodeIndex];
+    mat4 localMatrix;
+    localMatrix.from(node.matrix);
+    localMatrix.from(node.translation, node.rotation, node.scale);
+    mat4 worldMatrix = localMatrix * parentMatrix;
+    long long triangles = 0;
+    if (node.mesh >= 0)
+      triangles += renderMesh(node.mesh, worldMatrix);
+    for (auto child : node.children)
+      triangles += renderNode(child, worldMatrix);
+    return triangles;
+  }
+
+  long long frame() {
+    glUseProgram(program);
+    glEnable(GL_DEPTH_TEST);
+    mat4 projection = mat4::perspective(60 * M_PI / 180, aspect, 1, 10);
+    glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, false,
+                       &projection);
+    vec3 lightColor{1, 1, 1};
+    vec3 lightDirection = normalize(vec3{1, 5, 8});
+    vec3 pointLightPosition{0, 0, -1.5};
+    vec3 cameraPosition{0, 0, 0};
+    glUniform3fv(glGetUniformLocation(program, "lightColor"), 1, &lightColor);
+    glUniform3fv(glGetUniformLocation(program, "lightDirection"), 1,
+                 &lightDirection);
+    glUniform3fv(glGetUniformLocation(program, "pointLightPosition"), 1,
+                 &pointLightPosition);
+    glUniform3fv(glGetUniformLocation(program, "cameraPosition"), 1,
+                 &cameraPosition);
+
+    modelWorldMatrix.yRotate(0.1);
+    long long triangles = 0;
+    int sceneIndex = std::max(model.defaultScene, 0);
+    if (sceneIndex < model.scenes.size())
+      for (auto nodeIndex : model.scenes[sceneIndex].nodes)
+        triangles += renderNode(nodeIndex, modelWorldMatrix);
+    return triangles;
+  }
+};
+
+Scenario createGltfScenario(const std::string &name,
+                            const std::string &filename, float scale,
+                            float yRotate) {
+  auto scene = std::make_shared<GltfScene>();
+  return {name,
+          [=](int width, int height) {
+            if (!scene->loaded && !scene->load(filename))
+              return false;
+            scene->aspect = (float)width / height;
+            // 每个分辨率从相同的姿态开始
+            scene->modelWorldMatrix = mat4();
+            scene->modelWorldMatrix.translate(0, 0, -4)
+                .yRotate(yRotate)
+                .scale(scale);
+            return true;
+          },
+          [=]() { return scene->frame(); }};
+}
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options))
+    return 1;
+  if (options.threads.empty()) {
+    options.threads.push_back(1);
+    int hardware = (int)std::thread::hardware_concurrency();
+    if (hardware > 1)
+      options.threads.push_back(hardware);
+  }
+
+  auto scenarios = createQuadScenarios();
+  scenarios.push_back(createGltfScenario(
+      "gltf-cube", options.models + "/Cube/Cube.gltf", 1, 0.5));
+  scenarios.push_back(createGltfScenario(
+      "gltf-boombox", options.models + "/BoomBox/glTF/BoomBox.gltf", 160,
+      M_PI_4 + M_PI_2));
+
+  Jobs::setAffinity(options.affinity);
+  Jobs::setNumaAffinity(options.numa);
+  printf("{\n  \"hardwareThreads\": %d,\n  \"numaNodes\": %d,\n"
+         "  \"numaAffinity\": %s,\n  \"results\": [",
+         (int)std::thread::hardware_concurrency(), Jobs::nodeCount(),
+         options.numa ? "true" : "false");
+  if (!options.trace.empty())
+    Trace::start();
+  if (options.perf && !Perf::enable())
+    fprintf(stderr, "perf_event_open unavailable, --perf ignored\n");
+  Query *statisticsQuery = glCreateQuery();
+  bool first = true;
+  for (auto &scenario : scenarios) {
+    if (!options.scenarios.empty() &&
+        std::find(options.scenarios.begin(), options.scenarios.end(),
+                  scenario.name) == options.scenarios.end())
+      continue;
+
+    for (auto [width, height] : options.resolutions) {
+      auto framebuffer = createFramebuffer(width, height);
+      if (!scenario.setup(width, height)) {
+        glBindFramebuffer(GL_FRAMEBUFFER, nullptr);
+        deleteFramebuffer(framebuffer);
+        break;
+      }
+
+      for (int threads : options.threads) {
+        Jobs::setThreadCount(threads);
+
+        for (int i = 0; i < options.warmup; i++) {
+          glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+          scenario.frame();
+        }
+
+        // fragment 数由各线程自己的管线统计计数, 不在 shader 里共享计数器
+        long long triangles = 0;
+        Perf::endFrame();
+        glBeginQuery(GL_PIPELINE_STATISTICS, statisticsQuery);
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < options.frames; i++) {
+          glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+          triangles += scenario.frame();
+        }
+        double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - begin)
+                             .count();
+        glEndQuery(GL_PIPELINE_STATISTICS);
+        PipelineStatistics statistics;
+        glGetQueryPipelineStatistics(statisticsQuery, &statistics);
+        long long fragments = statistics.fragmentShaderInvocations;
+        PerfFrame perf = Perf::endFrame();
+
+        printf("%s\n    {\"scenario\": \"%s\", \"width\": %d, \"height\": %d, "
+               "\"threads\": %d, \"frames\": %d, \"seconds\": %.6f, "
+               "\"fps\": %.3f, \"triangles\": %lld, \"fragments\": %lld, "
+               "\"trianglesPerSecond\": %.1f, \"fragmentsPerSecond\": %.1f",
+               first ? "" : ",", scenario.name.c_str(), width, height, threads,
+               options.frames, seconds, options.frames / seconds, triangles,
+               fragments, triangles / seconds, fragments / seconds);
+        if (Perf::enabled())
+          printPerf(perf, options.frames);
+        printf("}");
+        fflush(stdout);
+        first = false;
+      }
+
+      glBindFramebuffer(GL_FRAMEBUFFER, nullptr);
+      deleteFramebuffer(framebuffer);
+    }
+  }
+  glDeleteQuery(statisticsQuery);
+  printf("\n  ]\n}\n");
+  if (!options.trace.empty() && !Trace::stop(options.trace.c_str()))
+    fprintf(stderr, "failed to write trace %s\n", options.trace.c_str());
+  return 0;
+}
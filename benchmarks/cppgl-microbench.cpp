@@ -0,0 +1,440 @@
+#include "CppGL/api.h"
+#include "CppGL/constant.h"
+#include "CppGL/math.h"
+#include "CppGL/shader.h"
+#include "CppGL/vertex-array.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CPPGL_HAS_TSC 1
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define CPPGL_HAS_TSC 1
+#endif
+
+/**
+ * @brief 单个 kernel 的微基准测试, 输入由固定种子生成, 每个 kernel 重复
+ * 多轮取最快一轮, 输出每次操作的 ns 和 TSC 周期数(仅 x86), 以及结果校验和,
+ * 修改 kernel 实现后校验和应保持不变
+ *
+ * cppgl-microbench [--iterations N] [--repeat N]
+ *                  [--kernels mat4-mul,normalize-vec3]
+ */
+
+using namespace CppGL;
+
+namespace {
+// 输入个数取2的幂, 数据常驻 L1/L2, 只测 kernel 本身
+const int INPUT_COUNT = 1024;
+
+// 阻止编译器把结果未被使用的计算消除
+template <typename T> inline void keep(T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  static volatile char sink;
+  sink = *reinterpret_cast<volatile char *>(&value);
+#endif
+}
+
+inline uint64_t readCycles() {
+#ifdef CPPGL_HAS_TSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+struct Random {
+  uint32_t state;
+  // xorshift32, 保证不同平台上输入一致
+  inline uint32_t next() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+  inline float range(float min, float max) {
+    return min + (next() >> 8) * (1.f / 16777216.f) * (max - min);
+  }
+};
+
+// 校验和按位累加 float, 不受求和顺序以外的因素影响
+inline uint64_t hashFloats(uint64_t hash, const float *values, int count) {
+  for (int i = 0; i < count; i++) {
+    uint32_t bits;
+    memcpy(&bits, &values[i], sizeof(bits));
+    hash = (hash ^ bits) * 1099511628211ull;
+  }
+  return hash;
+}
+
+/**
+ * @brief run(iterations) 执行 iterations 次操作, checksum() 对固定输入
+ * 执行一遍并返回结果的哈希
+ */
+struct Kernel {
+  std::string name;
+  std::function<void(long long)> run;
+  std::function<uint64_t()> checksum;
+};
+
+struct Options {
+  long long iterations = 1 << 22;
+  int repeat = 5;
+  std::vector<std::string> kernels{};
+};
+
+std::vector<std::string> split(const std::string &str, char separator) {
+  std::vector<std::string> parts;
+  size_t begin = 0;
+  while (begin <= str.size()) {
+    size_t end = str.find(separator, begin);
+    if (end == std::string::npos)
+      end = str.size();
+    if (end > begin)
+      parts.push_back(str.substr(begin, end - begin));
+    begin = end + 1;
+  }
+  return parts;
+}
+
+bool parseOptions(int argc, char **argv, Options &options) {
+  for (int i = 1; i < argc; i++) {
+    std::string key = argv[i];
+    if (i + 1 >= argc) {
+      fprintf(stderr, "missing value for %s\n", key.c_str());
+      return false;
+    }
+    std::string value = argv[++i];
+    if (key == "--iterations")
+      options.iterations = std::max(std::stoll(value), 1ll);
+    else if (key == "--repeat")
+      options.repeat = std::max(std::stoi(value), 1);
+    else if (key == "--kernels")
+      options.kernels = split(value, ',');
+    else {
+      fprintf(stderr, "unknown option %s\n", key.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+mat4 randomMatrix(Random &random) {
+  // 旋转+缩放+平移, 保证可逆
+  mat4 m;
+  m.identity()
+      .translate(random.range(-10, 10), random.range(-10, 10),
+                 random.range(-10, 10))
+      .yRotate(random.range(0, 6.28f))
+      .xRotate(random.range(0, 6.28f))
+      .scale(random.range(0.5f, 2));
+  return m;
+}
+
+std::vector<Kernel> createMathKernels() {
+  std::vector<Kernel> kernels;
+  Random random{0x9e3779b9};
+
+  std::vector<mat4> matrices(INPUT_COUNT);
+  std::vector<vec4> vectors(INPUT_COUNT);
+  for (auto &m : matrices)
+    m = randomMatrix(random);
+  for (auto &v : vectors)
+    v = {random.range(-1, 1), random.range(-1, 1), random.range(-1, 1), 1};
+
+  kernels.push_back(
+      {"mat4-mul",
+       [=](long long iterations) mutable {
+         const int mask = INPUT_COUNT - 1;
+         for (long long i = 0; i < iterations; i++) {
+           mat4 out = matrices[i & mask] * matrices[(i + 1) & mask];
+           keep(out);
+         }
+       },
+       [=]() mutable {
+         uint64_t hash = 14695981039346656037ull;
+         for (int i = 0; i < INPUT_COUNT; i++) {
+           mat4 out = matrices[i] * matrices[(i + 1) % INPUT_COUNT];
+           hash = hashFloats(hash, out.e, 16);
+         }
+         return hash;
+       }});
+
+  kernels.push_back(
+      {"mat4-mul-vec4",
+       [=](long long iterations) mutable {
+         const int mask = INPUT_COUNT - 1;
+         for (long long i = 0; i < iterations; i++) {
+           vec4 out = matrices[i & mask] * vectors[i & mask];
+           keep(out);
+         }
+       },
+       [=]() mutable {
+         uint64_t hash = 14695981039346656037ull;
+         for (int i = 0; i < INPUT_COUNT; i++) {
+           vec4 out = matrices[i] * vectors[i];
+           hash = hashFloats(hash, &out.x, 4);
+         }
+         return hash;
+       }});
+
+  kernels.push_back(
+      {"mat4-invert",
+       [=](long long iterations) mutable {
+         const int mask = INPUT_COUNT - 1;
+         for (long long i = 0; i < iterations; i++) {
+           mat4 out = matrices[i & mask];
+           out.invert();
+           keep(out);
+         }
+       },
+       [=]() mutable {
+         uint64_t hash = 14695981039346656037ull;
+         for (int i = 0; i < INPUT_COUNT; i++) {
+           mat4 out = matrices[i];
+           out.invert();
+           hash = hashFloats(hash, out.e, 16);
+         }
+         return hash;
+       }});
+
+  kernels.push_back(
+      {"normalize-vec3",
+       [=](long long iterations) mutable {
+         const int mask = INPUT_COUNT - 1;
+         for (long long i = 0; i < iterations; i++) {
+           vec3 out = normalize(vec3(vectors[i & mask]));
+           keep(out);
+         }
+       },
+       [=]() mutable {
+         uint64_t hash = 14695981039346656037ull;
+         for (int i = 0; i < INPUT_COUNT; i++) {
+           vec3 out = normalize(vec3(vectors[i]));
+           hash = hashFloats(hash, &out.x, 3);
+         }
+         return hash;
+       }});
+
+  // 屏幕空间三角形 + 其 boundingbox 内的采样点, 与光栅化时的输入分布一致
+  std::vector<triangle> triangles(INPUT_COUNT);
+  std::vector<vec2> points(INPUT_COUNT);
+  for (int i = 0; i < INPUT_COUNT; i++) {
+    float x = random.range(0, 1024), y = random.range(0, 1024);
+    vec4 a{x, y, 0.5, 1};
+    vec4 b{x + random.range(4, 64), y + random.range(-32, 32), 0.5, 1};
+    vec4 c{x + random.range(-32, 32), y + random.range(4, 64), 0.5, 1};
+    triangles[i] = {a, b, c};
+    points[i] = {x + random.range(-16, 48), y + random.range(-16, 48)};
+  }
+
+  kernels.push_back(
+      {"triangle-barycentric",
+       [=](long long iterations) mutable {
+         const int mask = INPUT_COUNT - 1;
+         for (long long i = 0; i < iterations; i++) {
+           vec3 out = triangles[i & mask].getBarycentric(points[i & mask]);
+           keep(out);
+         }
+       },
+       [=]() mutable {
+         uint64_t hash = 14695981039346656037ull;
+         for (int i = 0; i < INPUT_COUNT; i++) {
+           vec3 out = triangles[i].getBarycentric(points[i]);
+           hash = hashFloats(hash, &out.x, 3);
+         }
+         return hash;
+       }});
+
+  return kernels;
+}
+
+Kernel createTextureKernel(const std::string &name, int wrap,
+                           std::vector<uint8_t> &pixels) {
+  const int size = 256;
+  pixels.resize(size * size * 4);
+  for (int i = 0; i < size * size; i++) {
+    uint32_t h = i * 2654435761u;
+    memcpy(&pixels[i * 4], &h, 4);
+  }
+
+  // glTexImage2D 不拷贝数据, pixels 由 main 持有
+  auto texture = glCreateTexture();
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0, GL_RGBA,
+               GL_UNSIGNED_BYTE, pixels.data());
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+
+  Random random{0x2545f491};
+  std::vector<vec2> uvs(INPUT_COUNT);
+  for (auto &uv : uvs)
+    uv = wrap == GL_REPEAT ? vec2{random.range(-4, 4), random.range(-4, 4)}
+                           : vec2{random.range(0, 1), random.range(0, 1)};
+
+  // 每次采样前重新绑定, 不同 kernel 可以共用纹理单元0
+  auto bind = [=]() {
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+  };
+  return {name,
+          [=](long long iterations) {
+            bind();
+            const int mask = INPUT_COUNT - 1;
+            for (long long i = 0; i < iterations; i++) {
+              vec4 out = ShaderSource::texture2D(0, uvs[i & mask]);
+              keep(out);
+            }
+          },
+          [=]() {
+            bind();
+            uint64_t hash = 14695981039346656037ull;
+            for (int i = 0; i < INPUT_COUNT; i++) {
+              vec4 out = ShaderSource::texture2D(0, uvs[i]);
+              hash = hashFloats(hash, &out.x, 4);
+            }
+            return hash;
+          }};
+}
+
+/**
+ * @brief 通过 VertexArray::compile 取得与绘制时相同的读取函数,
+ * 顺序读取 INPUT_COUNT 个顶点
+ */
+Kernel createFetchKernel(const std::string &name, int size, int type,
+                         bool normalized, int elementLen) {
+  VertexArray vao;
+  auto &info = vao.attribute(0);
+  info.enabled = true;
+  info.size = size;
+  info.type = type;
+  info.normalized = normalized;
+  vao.compile();
+  auto fetch = vao.attributes[0].fetch;
+  int stride = vao.attributes[0].byteStride;
+
+  Random random{0x6c078965};
+  std::vector<uint8_t> data(INPUT_COUNT * elementLen);
+  if (type == GL_FLOAT) {
+    for (int i = 0; i < INPUT_COUNT * size; i++) {
+      float f = random.range(-1, 1);
+      memcpy(&data[i * 4], &f, 4);
+    }
+  } else if (type == GL_HALF_FLOAT) {
+    // 只生成规格化数, 非规格化数会让转换走 CPU 的慢速路径
+    for (int i = 0; i < INPUT_COUNT * size; i++) {
+      uint16_t exponent = 1 + random.next() % 30;
+      uint16_t h = (random.next() & 0x83ff) | exponent << 10;
+      memcpy(&data[i * 2], &h, 2);
+    }
+  } else {
+    for (auto &byte : data)
+      byte = random.next() >> 24;
+  }
+
+  return {name,
+          [=](long long iterations) {
+            const int mask = INPUT_COUNT - 1;
+            float out[4];
+            for (long long i = 0; i < iterations; i++) {
+              fetch(data.data() + (i & mask) * stride, out);
+              keep(out);
+            }
+          },
+          [=]() {
+            uint64_t hash = 14695981039346656037ull;
+            float out[4];
+            for (int i = 0; i < INPUT_COUNT; i++) {
+              fetch(data.data() + i * stride, out);
+              hash = hashFloats(hash, out, size);
+            }
+            return hash;
+          }};
+}
+
+std::vector<Kernel> createFetchKernels() {
+  return {
+      createFetchKernel("fetch-float3", 3, GL_FLOAT, false, 12),
+      createFetchKernel("fetch-half4", 4, GL_HALF_FLOAT, false, 8),
+      createFetchKernel("fetch-ubyte4-normalized", 4, GL_UNSIGNED_BYTE, true,
+                        4),
+      createFetchKernel("fetch-short2-normalized", 2, GL_SHORT, true, 4),
+      createFetchKernel("fetch-int-2-10-10-10-rev", 4, GL_INT_2_10_10_10_REV,
+                        true, 4),
+  };
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options))
+    return 1;
+
+  std::vector<uint8_t> clampPixels, repeatPixels;
+  auto kernels = createMathKernels();
+  kernels.push_back(
+      createTextureKernel("texture2D-clamp", GL_CLAMP_TO_EDGE, clampPixels));
+  kernels.push_back(
+      createTextureKernel("texture2D-repeat", GL_REPEAT, repeatPixels));
+  for (auto &kernel : createFetchKernels())
+    kernels.push_back(kernel);
+
+  printf("{\n  \"iterations\": %lld,\n  \"repeat\": %d,\n  \"tsc\": %s,\n"
+         "  \"results\": [",
+         options.iterations, options.repeat,
+#ifdef CPPGL_HAS_TSC
+         "true"
+#else
+         "false"
+#endif
+  );
+  bool first = true;
+  for (auto &kernel : kernels) {
+    if (!options.kernels.empty() &&
+        std::find(options.kernels.begin(), options.kernels.end(),
+                  kernel.name) == options.kernels.end())
+      continue;
+
+    // 预热一轮, 让数据进入缓存
+    kernel.run(std::min(options.iterations, (long long)INPUT_COUNT * 16));
+
+    // 取最快的一轮, 排除调度和中断的干扰
+    double bestSeconds = 1e30;
+    uint64_t bestCycles = UINT64_MAX;
+    for (int i = 0; i < options.repeat; i++) {
+      auto begin = std::chrono::steady_clock::now();
+      uint64_t beginCycles = readCycles();
+      kernel.run(options.iterations);
+      uint64_t cycles = readCycles() - beginCycles;
+      double seconds = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - begin)
+                           .count();
+      bestSeconds = std::min(bestSeconds, seconds);
+      bestCycles = std::min(bestCycles, cycles);
+    }
+
+    printf("%s\n    {\"kernel\": \"%s\", \"nsPerOp\": %.3f, "
+           "\"cyclesPerOp\": %.2f, \"checksum\": \"%016llx\"}",
+           first ? "" : ",", kernel.name.c_str(),
+           bestSeconds * 1e9 / options.iterations,
+           (double)bestCycles / options.iterations,
+           (unsigned long long)kernel.checksum());
+    fflush(stdout);
+    first = false;
+  }
+  printf("\n  ]\n}\n");
+  return 0;
+}
@@ -160,7 +160,7 @@ int main(void) {
 
   const auto indexBuffer = glCreateBuffer();
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cubeVertexTexcoords),
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cubeVertexIndices),
                cubeVertexIndices, GL_STATIC_DRAW);
 
   static uint8_t checkerTextureData[] = {
@@ -18,8 +18,11 @@ using namespace rttr;
 
 const int ARRAY_BUFFER = 34962;
 const int ELEMENT_ARRAY_BUFFER = 34963;
+const int UNSIGNED_INT = 5125;
 const int UNSIGNED_SHORT = 5123;
 const int UNSIGNED_BYTE = 5121;
+const int SHORT = 5122;
+const int BYTE = 5120;
 const int FLOAT = 5126;
 
 #include "CppGL/marco.h" // 必须在所有include后面
@@ -156,12 +159,27 @@ int main(int argc, char **argv) {
 
   if (argc > 1)
     filename = argv[1];
+  auto baseDir = filename.substr(0, filename.find_last_of("/\\") + 1);
 
   tinygltf::Model model;
   if (!loadModel(model, filename.c_str()))
     return 1;
   // dbgModel(model);
 
+  // 外部 .bin 能映射时释放 tinygltf 读出的副本, 之后只从映射读取
+  std::vector<std::shared_ptr<MappedFile>> mappedBuffers(model.buffers.size());
+  for (int i = 0; i < model.buffers.size(); i++) {
+    auto &buffer = model.buffers[i];
+    if (buffer.uri.empty() || buffer.uri.rfind("data:", 0) == 0)
+      continue;
+    auto file = MappedFile::open(baseDir + buffer.uri);
+    if (file == nullptr || file->size < buffer.data.size())
+      continue;
+    mappedBuffers[i] = file;
+    buffer.data.clear();
+    buffer.data.shrink_to_fit();
+  }
+
   vec3 ambientLightColor{1, 1, 1};
   float ambientLightIntensity = 0.3;
   vec3 directionalLightColor{1, 1, 1};
@@ -175,6 +193,7 @@ int main(int argc, char **argv) {
   Program *glProgram = initGLProgram();
   std::unordered_map<int, Buffer *> glBufferCache;
   std::unordered_map<int, Texture *> glTextureCache;
+  std::unordered_map<const tinygltf::Primitive *, VertexArray *> glVaoCache;
   int dpr = 1;
   glUseProgram(glProgram);
   glViewport(0, 0, 300 * dpr, 150 * dpr);
@@ -278,8 +297,17 @@ int main(int argc, char **argv) {
     glBufferCache.emplace(bufferViewIndex, glBuffer);
 
     glBindBuffer(bufferTarget, glBuffer);
-    glBufferData(bufferTarget, bufferView.byteLength,
-                 &buffer.data.at(0) + bufferView.byteOffset, GL_STATIC_DRAW);
+    // 外部 .bin 直接使用上面的映射, 其余拷贝 tinygltf 读出的数据
+    bool mapped = false;
+    if (mappedBuffers[bufferView.buffer] != nullptr) {
+      auto path = baseDir + buffer.uri;
+      mapped = glBufferDataFromFile(bufferTarget, path.c_str(),
+                                    bufferView.byteOffset,
+                                    bufferView.byteLength, FileAdvice::RANDOM);
+    }
+    if (!mapped && !buffer.data.empty())
+      glBufferData(bufferTarget, bufferView.byteLength,
+                   &buffer.data.at(0) + bufferView.byteOffset, GL_STATIC_DRAW);
 
     return glBuffer;
   };
@@ -304,6 +332,10 @@ int main(int argc, char **argv) {
       componentType = GL_UNSIGNED_BYTE;
     if (accessor.componentType == UNSIGNED_SHORT)
       componentType = GL_UNSIGNED_SHORT;
+    if (accessor.componentType == BYTE)
+      componentType = GL_BYTE;
+    if (accessor.componentType == SHORT)
+      componentType = GL_SHORT;
 
     glEnableVertexAttribArray(attributeLocation);
     glVertexAttribPointer(attributeLocation, size, componentType,
@@ -319,14 +351,24 @@ int main(int argc, char **argv) {
 
     for (auto &primitive : mesh.primitives) {
       auto &indciesAccessor = model.accessors[primitive.indices];
-      uploadBuffer(indciesAccessor.bufferView);
 
-      uploadAttribute(primitive.attributes["POSITION"],
-                      glGetAttribLocation(glProgram, "position"));
-      uploadAttribute(primitive.attributes["TEXCOORD_0"],
-                      glGetAttribLocation(glProgram, "texcoord"));
-      uploadAttribute(primitive.attributes["NORMAL"],
-                      glGetAttribLocation(glProgram, "normal"));
+      // 每个primitive一个vao, 之后的帧只需要绑定
+      auto search = glVaoCache.find(&primitive);
+      if (search != glVaoCache.end()) {
+        glBindVertexArray(search->second);
+      } else {
+        auto vao = glCreateVertexArray();
+        glVaoCache.emplace(&primitive, vao);
+        glBindVertexArray(vao);
+
+        uploadBuffer(indciesAccessor.bufferView);
+        uploadAttribute(primitive.attributes["POSITION"],
+                        glGetAttribLocation(glProgram, "position"));
+        uploadAttribute(primitive.attributes["TEXCOORD_0"],
+                        glGetAttribLocation(glProgram, "texcoord"));
+        uploadAttribute(primitive.attributes["NORMAL"],
+                        glGetAttribLocation(glProgram, "normal"));
+      }
 
       auto &material = model.materials[primitive.material];
 
@@ -344,11 +386,14 @@ int main(int argc, char **argv) {
         componentType = GL_UNSIGNED_BYTE;
       if (indciesAccessor.componentType == UNSIGNED_SHORT)
         componentType = GL_UNSIGNED_SHORT;
+      if (indciesAccessor.componentType == UNSIGNED_INT)
+        componentType = GL_UNSIGNED_INT;
 
       int mode = GL_TRIANGLES;
       glDrawElements(mode, indciesAccessor.count, componentType, 0);
       // glDrawElements(mode, 3, componentType, 0);
     }
+    glBindVertexArray(nullptr);
   };
 
   auto renderNode = [&](auto &&self, int nodeIndex, mat4 parentMatrix) -> void {
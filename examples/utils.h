@@ -2,6 +2,8 @@
 #include <CppGL/buffer.h>
 #include <CppGL/constant.h>
 #include <CppGL/global-state.h>
+#include <CppGL/heatmap.h>
+#include <CppGL/job-system.h>
 #include <CppGL/math.h>
 #include <chrono>
 #include <cmath>
@@ -29,35 +31,37 @@ inline void displayBuffers(bool wait = true) {
   Mat image = Mat::zeros(height, width, CV_8UC3);
   Mat imageZ = Mat::zeros(height, width, CV_8UC3);
 
-#pragma omp parallel for
-  for (int x = 0; x < (int)width; x++)
-    for (int y = 0; y < (int)height; y++) {
-      int bufferIndex = x + y * width;
-      float depth = clamp(zBuffer[bufferIndex], 0, 1);
-      int pixelIndex = (x + (height - y) * width) * 3;
-      if (frameBufferTextureBuffer->internalFormat == GL_RGBA) {
-        if (frameBufferTextureBuffer->dataType == GL_FLOAT) {
-          vec4 *frameBuffer = (vec4 *)frameBufferTextureBuffer->data;
-          vec4 &pixel = frameBuffer[bufferIndex];
-          image.data[pixelIndex] = (uchar)(pixel.b * 255);
-          image.data[pixelIndex + 1] = (uchar)(pixel.g * 255);
-          image.data[pixelIndex + 2] = (uchar)(pixel.r * 255);
-        } else if (frameBufferTextureBuffer->dataType == GL_UNSIGNED_BYTE) {
-          uint8_t *frameBuffer = (uint8_t *)frameBufferTextureBuffer->data;
-          image.data[pixelIndex] = frameBuffer[bufferIndex * 4 + 2];
-          image.data[pixelIndex + 1] = frameBuffer[bufferIndex * 4 + 1];
-          image.data[pixelIndex + 2] = frameBuffer[bufferIndex * 4];
+  // 按行并行读回, 每个任务处理相邻的若干行
+  Jobs::parallelFor((int)height, 16, [&](int first, int last) {
+    for (int y = first; y < last; y++)
+      for (int x = 0; x < (int)width; x++) {
+        int bufferIndex = x + y * width;
+        float depth = clamp(zBuffer[bufferIndex], 0, 1);
+        int pixelIndex = (x + (height - y) * width) * 3;
+        if (frameBufferTextureBuffer->internalFormat == GL_RGBA) {
+          if (frameBufferTextureBuffer->dataType == GL_FLOAT) {
+            vec4 *frameBuffer = (vec4 *)frameBufferTextureBuffer->data;
+            vec4 &pixel = frameBuffer[bufferIndex];
+            image.data[pixelIndex] = (uchar)(pixel.b * 255);
+            image.data[pixelIndex + 1] = (uchar)(pixel.g * 255);
+            image.data[pixelIndex + 2] = (uchar)(pixel.r * 255);
+          } else if (frameBufferTextureBuffer->dataType == GL_UNSIGNED_BYTE) {
+            uint8_t *frameBuffer = (uint8_t *)frameBufferTextureBuffer->data;
+            image.data[pixelIndex] = frameBuffer[bufferIndex * 4 + 2];
+            image.data[pixelIndex + 1] = frameBuffer[bufferIndex * 4 + 1];
+            image.data[pixelIndex + 2] = frameBuffer[bufferIndex * 4];
+          }
         }
-      }
 
-      // image.data[pixelIndex] = 255;   // b
-      // image.data[pixelIndex + 1] = 0; // g
-      // image.data[pixelIndex + 2] = 0; // r
+        // image.data[pixelIndex] = 255;   // b
+        // image.data[pixelIndex + 1] = 0; // g
+        // image.data[pixelIndex + 2] = 0; // r
 
-      imageZ.data[pixelIndex] = (uchar)(depth * 255);
-      imageZ.data[pixelIndex + 1] = (uchar)(depth * 255);
-      imageZ.data[pixelIndex + 2] = (uchar)(depth * 255);
-    }
+        imageZ.data[pixelIndex] = (uchar)(depth * 255);
+        imageZ.data[pixelIndex + 1] = (uchar)(depth * 255);
+        imageZ.data[pixelIndex + 2] = (uchar)(depth * 255);
+      }
+  });
 
   imshow("zBuffer", imageZ);
   imshow("frameBuffer", image);
@@ -65,6 +69,34 @@ inline void displayBuffers(bool wait = true) {
     waitKey(0);
 }
 
+/**
+ * @brief 显示 glBindHeatmap 收集的某一项计数, 以最大值归一化
+ */
+inline void displayHeatmap(const Heatmap &heatmap, Heatmap::Channel channel,
+                           bool wait = true) {
+  const int width = heatmap.width;
+  const int height = heatmap.height;
+  std::vector<uint8_t> rgba(width * height * 4);
+  heatmap.toImage(channel, rgba.data());
+
+  Mat image = Mat::zeros(height, width, CV_8UC3);
+  for (int y = 0; y < height; y++)
+    for (int x = 0; x < width; x++) {
+      int bufferIndex = x + y * width;
+      // 与 displayBuffers 一样上下翻转
+      int pixelIndex = (x + (height - 1 - y) * width) * 3;
+      image.data[pixelIndex] = rgba[bufferIndex * 4 + 2];
+      image.data[pixelIndex + 1] = rgba[bufferIndex * 4 + 1];
+      image.data[pixelIndex + 2] = rgba[bufferIndex * 4];
+    }
+
+  const char *names[] = {"heatmap depth tests", "heatmap fs invocations",
+                         "heatmap fs cycles"};
+  imshow(names[channel], image);
+  if (wait)
+    waitKey(0);
+}
+
 inline void renderLoop(std::function<void(void)> fn) {
   while (1) {
     fn();
@@ -1,17 +1,25 @@
 #pragma once
 
+#include "blend.h"
 #include "buffer.h"
 #include "constant.h"
 #include "debug.h"
 #include "global-state.h"
+#include "heatmap.h"
+#include "job-system.h"
+#include "mapped-file.h"
 #include "math.h"
+#include "perf-counter.h"
 #include "program.h"
+#include "query.h"
 #include "rttr/property.h"
 #include "rttr/string_view.h"
 #include "rttr/type.h"
 #include "rttr/variant.h"
 #include "shader.h"
+#include "stencil.h"
 #include "texture.h"
+#include "trace.h"
 #include "vertex-array.h"
 #include <CppGL/rttr.h>
 #include <_types/_uint8_t.h>
@@ -34,13 +42,95 @@ using str = rttr::string_view;
 
 namespace Helper {
 Texture *getTextureFrom(int location);
-void setUniform(
-    int location,
-    std::function<void(rttr::property &, rttr::property &, ShaderSource *,
-                       ShaderSource *, rttr::type &, rttr::type &)>
-        fn);
-void draw(int mode, int first, int count, int dataType, const void *indices);
+// 一个像素的字节数, 分量数乘以分量大小, 不支持的组合返回0
+int texelSize(int format, int dataType);
+/**
+ * @brief 一次子绘制, 无索引时 first 为起始顶点, 有索引时为起始索引位置
+ * indices 为空时使用 vao 绑定的 element buffer
+ */
+struct DrawCommand {
+  int first;
+  int count;
+  const void *indices;
+  int instanceCount;
+  int baseVertex;
+  int baseInstance;
+};
+// 所有子绘制共用一次管线准备
+void draw(int mode, int dataType, const DrawCommand *commands,
+          int commandCount);
+inline void draw(int mode, int first, int count, int dataType,
+                 const void *indices, int instanceCount = 1) {
+  DrawCommand command{first, count, indices, instanceCount, 0, 0};
+  draw(mode, dataType, &command, 1);
+}
+box2 getClipBox(int width, int height);
+// 光栅化把屏幕划分为 TILE_SIZE 的正方形 tile
+const int TILE_SIZE = 64;
+/**
+ * @brief 按 tile 行并行执行 job(tileY), Jobs::numaAffinity 开启时每行固定由
+ * 同一个 worker 执行; 绘制、glClear 和附件分配使用同样的划分,
+ * 所以一行的颜色和深度内存总是由同一个线程访问
+ */
+void forEachTileRow(int tilesY, const std::function<void(int tileY)> &job);
+/**
+ * @brief 开启 NUMA 绑定时由各 tile 行的归属线程清零新分配的附件内存,
+ * 第一次写入决定内存页所在的节点
+ */
+void firstTouch(TextureBuffer *buffer);
+/**
+ * @brief 默认 framebuffer 还没有附件时按 width x height 分配颜色、深度和
+ * stencil, 并直接填充清理值, 不受 scissor 和 write mask 影响
+ */
+void initDefaultFramebuffer(int width, int height);
 inline float if0Be1(float a) { return a == 0 ? 1 : a; }
+inline VertexArray *getVertexArray() {
+  auto vao = GLOBAL::GLOBAL_STATE->VERTEX_ARRAY_BINDING;
+  if (vao == nullptr)
+    vao = GLOBAL::DEFAULT_VERTEX_ARRAY;
+  return vao;
+}
+inline Program::UniformSlot *getUniformSlot(int location) {
+  auto program = GLOBAL::GLOBAL_STATE->CURRENT_PROGRAM;
+  if (program == nullptr || location < 0 ||
+      location >= program->uniformSlots.size())
+    return nullptr;
+  return &program->uniformSlots[location];
+}
+inline Buffer *getBuffer(int location) {
+  if (location == GL_ARRAY_BUFFER)
+    return GLOBAL::GLOBAL_STATE->ARRAY_BUFFER_BINDING;
+  if (location == GL_ELEMENT_ARRAY_BUFFER)
+    return getVertexArray()->indexBuffer;
+  if (location == GL_UNIFORM_BUFFER)
+    return GLOBAL::GLOBAL_STATE->UNIFORM_BUFFER_BINDING;
+  return nullptr;
+}
+// target 不支持时返回空
+inline Query **getQuerySlot(int target) {
+  auto state = GLOBAL::GLOBAL_STATE;
+  if (target == GL_TIME_ELAPSED)
+    return &state->CURRENT_TIME_ELAPSED_QUERY;
+  if (target == GL_SAMPLES_PASSED)
+    return &state->CURRENT_SAMPLES_PASSED_QUERY;
+  if (target == GL_ANY_SAMPLES_PASSED)
+    return &state->CURRENT_ANY_SAMPLES_PASSED_QUERY;
+  if (target == GL_PIPELINE_STATISTICS)
+    return &state->CURRENT_PIPELINE_STATISTICS_QUERY;
+  return nullptr;
+}
+// 只有计数类的 query 进行中时绘制才统计
+inline bool statisticsEnabled() {
+  auto state = GLOBAL::GLOBAL_STATE;
+  return state->CURRENT_SAMPLES_PASSED_QUERY != nullptr ||
+         state->CURRENT_ANY_SAMPLES_PASSED_QUERY != nullptr ||
+         state->CURRENT_PIPELINE_STATISTICS_QUERY != nullptr;
+}
+// 条件渲染的 query 没有 sample 通过时, 绘制和清理都被跳过
+inline bool conditionalRenderDiscards() {
+  auto query = GLOBAL::GLOBAL_STATE->CONDITIONAL_RENDER_QUERY;
+  return query != nullptr && query->available && query->result == 0;
+}
 } // namespace Helper
 
 inline Shader *glCreateShader(Shader::Type type) { return new Shader(type); }
@@ -63,46 +153,50 @@ inline Buffer *glCreateBuffer() { return new Buffer(); }
 inline void glBindBuffer(int location, Buffer *buffer) {
   if (location == GL_ARRAY_BUFFER)
     GLOBAL::GLOBAL_STATE->ARRAY_BUFFER_BINDING = buffer;
-  if (location == GL_ELEMENT_ARRAY_BUFFER) {
-    auto vao = GLOBAL::GLOBAL_STATE->VERTEX_ARRAY_BINDING;
-    if (vao == nullptr)
-      vao = GLOBAL::DEFAULT_VERTEX_ARRAY;
-    vao->indexBuffer = buffer;
-  }
+  if (location == GL_ELEMENT_ARRAY_BUFFER)
+    Helper::getVertexArray()->indexBuffer = buffer;
+  if (location == GL_UNIFORM_BUFFER)
+    GLOBAL::GLOBAL_STATE->UNIFORM_BUFFER_BINDING = buffer;
 }
-inline void glBufferData(int location, int length, const void *data,
-                         int usage) {
-  Buffer *target = nullptr;
-
-  if (location == GL_ARRAY_BUFFER)
-    target = GLOBAL::GLOBAL_STATE->ARRAY_BUFFER_BINDING;
-  if (location == GL_ELEMENT_ARRAY_BUFFER) {
-    auto vao = GLOBAL::GLOBAL_STATE->VERTEX_ARRAY_BINDING;
-    if (vao == nullptr)
-      vao = GLOBAL::DEFAULT_VERTEX_ARRAY;
-    target = vao->indexBuffer;
-  }
-
-  if (target != nullptr) {
-    target->data = data;
-    target->length = length;
-  }
+inline void glBindBufferRange(int location, int index, Buffer *buffer,
+                              int offset, int size) {
+  auto state = GLOBAL::GLOBAL_STATE;
+  if (location != GL_UNIFORM_BUFFER || index < 0 ||
+      index >= state->uniformBufferBindings.size())
+    return;
+  state->uniformBufferBindings[index] = {buffer, offset, size};
+  state->UNIFORM_BUFFER_BINDING = buffer;
+}
+inline void glBindBufferBase(int location, int index, Buffer *buffer) {
+  glBindBufferRange(location, index, buffer, 0, 0);
+}
+inline void glDeleteBuffer(Buffer *buffer) {
+  buffer->release();
+  delete buffer;
+}
+void glBufferData(int location, int length, const void *data, int usage);
+void glBufferSubData(int location, int offset, int length, const void *data);
+void *glMapBufferRange(int location, int offset, int length, int access);
+bool glUnmapBuffer(int location);
+/**
+ * @brief 用文件中 [offset, offset + length) 的数据作为 buffer 内容, 不拷贝,
+ * 由库持有文件映射, 映射的数据只读
+ */
+bool glBufferDataFromFile(int location, const char *path, size_t offset,
+                          int length, FileAdvice advice = FileAdvice::NORMAL);
+inline VertexArray *glCreateVertexArray() { return new VertexArray(); }
+inline void glBindVertexArray(VertexArray *vao) {
+  GLOBAL::GLOBAL_STATE->VERTEX_ARRAY_BINDING = vao;
 }
 inline void glEnableVertexAttribArray(int location) {
-  auto vao = GLOBAL::DEFAULT_VERTEX_ARRAY;
-  // 设置默认的vao
-  if (vao->attributes.size() < location + 1)
-    vao->attributes.resize(location + 1);
-
-  vao->attributes[location] = {true};
+  Helper::getVertexArray()->attribute(location).enabled = true;
+}
+inline void glDisableVertexAttribArray(int location) {
+  Helper::getVertexArray()->attribute(location).enabled = false;
 }
 inline void glVertexAttribPointer(int location, int size, int type,
                                   bool normalized, int stride, int offset) {
-  auto vao = GLOBAL::DEFAULT_VERTEX_ARRAY;
-  if (vao->attributes.size() < location + 1)
-    vao->attributes.resize(location + 1);
-
-  auto &attributeInfo = vao->attributes[location];
+  auto &attributeInfo = Helper::getVertexArray()->attribute(location);
   attributeInfo.buffer = GLOBAL::GLOBAL_STATE->ARRAY_BUFFER_BINDING;
   attributeInfo.type = type;
   attributeInfo.stride = stride;
@@ -110,13 +204,30 @@ inline void glVertexAttribPointer(int location, int size, int type,
   attributeInfo.size = size;
   attributeInfo.normalized = normalized;
 }
+inline void glVertexAttribDivisor(int location, int divisor) {
+  Helper::getVertexArray()->attribute(location).divisor = divisor;
+}
 inline int glGetAttribLocation(Program *program, str name) {
   auto dataInfo = program->attributes[name];
   return dataInfo.location;
 }
 inline int glGetUniformLocation(Program *program, str name) {
-  auto dataInfo = program->unifroms[name];
-  return dataInfo.location;
+  auto search = program->unifroms.find(name);
+  if (search == program->unifroms.end())
+    return -1;
+  return search->second.location;
+}
+inline int glGetUniformBlockIndex(Program *program, str name) {
+  auto &blocks = program->uniformBlocks;
+  for (int i = 0; i < blocks.size(); i++)
+    if (blocks[i].name == name)
+      return i;
+  return GL_INVALID_INDEX;
+}
+inline void glUniformBlockBinding(Program *program, int blockIndex,
+                                  int binding) {
+  if (blockIndex >= 0 && blockIndex < program->uniformBlocks.size())
+    program->uniformBlocks[blockIndex].binding = binding;
 }
 inline Texture *glCreateTexture() { return new Texture(); }
 inline void glBindTexture(int location, Texture *tex) {
@@ -148,6 +259,9 @@ inline void glViewport(float x, float y, float w, float h) {
   GLOBAL::GLOBAL_STATE->VIEWPORT.z = w;
   GLOBAL::GLOBAL_STATE->VIEWPORT.w = h;
 }
+inline void glScissor(int x, int y, int w, int h) {
+  GLOBAL::GLOBAL_STATE->SCISSOR_BOX = {(float)x, (float)y, (float)w, (float)h};
+}
 inline void glClearColor(float r, float g, float b, float a) {
   GLOBAL::GLOBAL_STATE->COLOR_CLEAR_VALUE = {r, g, b, a};
 }
@@ -156,30 +270,190 @@ inline void glEnable(int feature) {
     GLOBAL::GLOBAL_STATE->CULL_FACE = GL_TRUE;
   if (feature == GL_DEPTH_TEST)
     GLOBAL::GLOBAL_STATE->DEPTH_TEST = GL_TRUE;
+  if (feature == GL_BLEND)
+    GLOBAL::GLOBAL_STATE->BLEND = GL_TRUE;
+  if (feature == GL_STENCIL_TEST)
+    GLOBAL::GLOBAL_STATE->STENCIL_TEST = GL_TRUE;
+  if (feature == GL_SCISSOR_TEST)
+    GLOBAL::GLOBAL_STATE->SCISSOR_TEST = GL_TRUE;
+  if (feature == GL_PRIMITIVE_RESTART_FIXED_INDEX)
+    GLOBAL::GLOBAL_STATE->PRIMITIVE_RESTART_FIXED_INDEX = GL_TRUE;
+}
+inline void glDisable(int feature) {
+  if (feature == GL_CULL_FACE)
+    GLOBAL::GLOBAL_STATE->CULL_FACE = GL_FALSE;
+  if (feature == GL_DEPTH_TEST)
+    GLOBAL::GLOBAL_STATE->DEPTH_TEST = GL_FALSE;
+  if (feature == GL_BLEND)
+    GLOBAL::GLOBAL_STATE->BLEND = GL_FALSE;
+  if (feature == GL_STENCIL_TEST)
+    GLOBAL::GLOBAL_STATE->STENCIL_TEST = GL_FALSE;
+  if (feature == GL_SCISSOR_TEST)
+    GLOBAL::GLOBAL_STATE->SCISSOR_TEST = GL_FALSE;
+  if (feature == GL_PRIMITIVE_RESTART_FIXED_INDEX)
+    GLOBAL::GLOBAL_STATE->PRIMITIVE_RESTART_FIXED_INDEX = GL_FALSE;
+}
+inline void glBlendFuncSeparate(int srcRGB, int dstRGB, int srcAlpha,
+                                int dstAlpha) {
+  GLOBAL::GLOBAL_STATE->BLEND_SRC_RGB = (BlendFunc)srcRGB;
+  GLOBAL::GLOBAL_STATE->BLEND_DST_RGB = (BlendFunc)dstRGB;
+  GLOBAL::GLOBAL_STATE->BLEND_SRC_ALPHA = (BlendFunc)srcAlpha;
+  GLOBAL::GLOBAL_STATE->BLEND_DST_ALPHA = (BlendFunc)dstAlpha;
+}
+inline void glBlendFunc(int src, int dst) {
+  glBlendFuncSeparate(src, dst, src, dst);
+}
+inline void glBlendEquationSeparate(int modeRGB, int modeAlpha) {
+  GLOBAL::GLOBAL_STATE->BLEND_EQUATION_RGB = (BlendEquation)modeRGB;
+  GLOBAL::GLOBAL_STATE->BLEND_EQUATION_ALPHA = (BlendEquation)modeAlpha;
+}
+inline void glBlendEquation(int mode) { glBlendEquationSeparate(mode, mode); }
+inline void glBlendColor(float r, float g, float b, float a) {
+  GLOBAL::GLOBAL_STATE->BLEND_COLOR = {r, g, b, a};
+}
+inline void glColorMask(bool r, bool g, bool b, bool a) {
+  GLOBAL::GLOBAL_STATE->COLOR_WRITEMASK = r | g << 1 | b << 2 | a << 3;
+}
+inline void glDepthMask(bool flag) {
+  GLOBAL::GLOBAL_STATE->DEPTH_WRITEMASK = flag;
+}
+inline void glClearStencil(int s) {
+  GLOBAL::GLOBAL_STATE->STENCIL_CLEAR_VALUE = s;
+}
+inline void glStencilFuncSeparate(int face, int func, int ref, int mask) {
+  auto state = GLOBAL::GLOBAL_STATE;
+  if (face == GL_FRONT || face == GL_FRONT_AND_BACK) {
+    state->STENCIL_FUNC = (StencilFunc)func;
+    state->STENCIL_REF = ref;
+    state->STENCIL_VALUE_MASK = mask;
+  }
+  if (face == GL_BACK || face == GL_FRONT_AND_BACK) {
+    state->STENCIL_BACK_FUNC = (StencilFunc)func;
+    state->STENCIL_BACK_REF = ref;
+    state->STENCIL_BACK_VALUE_MASK = mask;
+  }
+}
+inline void glStencilFunc(int func, int ref, int mask) {
+  glStencilFuncSeparate(GL_FRONT_AND_BACK, func, ref, mask);
+}
+inline void glStencilOpSeparate(int face, int fail, int zfail, int zpass) {
+  auto state = GLOBAL::GLOBAL_STATE;
+  if (face == GL_FRONT || face == GL_FRONT_AND_BACK) {
+    state->STENCIL_FAIL = (StencilAction)fail;
+    state->STENCIL_PASS_DEPTH_FAIL = (StencilAction)zfail;
+    state->STENCIL_PASS_DEPTH_PASS = (StencilAction)zpass;
+  }
+  if (face == GL_BACK || face == GL_FRONT_AND_BACK) {
+    state->STENCIL_BACK_FAIL = (StencilAction)fail;
+    state->STENCIL_BACK_PASS_DEPTH_FAIL = (StencilAction)zfail;
+    state->STENCIL_BACK_PASS_DEPTH_PASS = (StencilAction)zpass;
+  }
+}
+inline void glStencilOp(int fail, int zfail, int zpass) {
+  glStencilOpSeparate(GL_FRONT_AND_BACK, fail, zfail, zpass);
+}
+inline void glStencilMaskSeparate(int face, int mask) {
+  if (face == GL_FRONT || face == GL_FRONT_AND_BACK)
+    GLOBAL::GLOBAL_STATE->STENCIL_WRITE_MASK = mask;
+  if (face == GL_BACK || face == GL_FRONT_AND_BACK)
+    GLOBAL::GLOBAL_STATE->STENCIL_BACK_WRITE_MASK = mask;
+}
+inline void glStencilMask(int mask) {
+  glStencilMaskSeparate(GL_FRONT_AND_BACK, mask);
 }
 inline void glActiveTexture(int textureUint) {
   GLOBAL::GLOBAL_STATE->ACTIVE_TEXTURE = textureUint;
 }
 inline void glDrawElements(int mode, int count, int dataType,
                            const void *indices) {
+  CPPGL_TRACE("gl", "glDrawElements");
   Helper::draw(mode, 0, count, dataType, indices);
 }
 inline void glDrawArrays(int mode, int first, int count) {
+  CPPGL_TRACE("gl", "glDrawArrays");
   Helper::draw(mode, first, count, 0, 0);
 }
+inline void glDrawElementsInstanced(int mode, int count, int dataType,
+                                    const void *indices, int instanceCount) {
+  CPPGL_TRACE("gl", "glDrawElementsInstanced");
+  Helper::draw(mode, 0, count, dataType, indices, instanceCount);
+}
+inline void glDrawArraysInstanced(int mode, int first, int count,
+                                  int instanceCount) {
+  CPPGL_TRACE("gl", "glDrawArraysInstanced");
+  Helper::draw(mode, first, count, 0, 0, instanceCount);
+}
+void glMultiDrawArrays(int mode, const int *first, const int *count,
+                       int drawCount);
+void glMultiDrawElements(int mode, const int *count, int dataType,
+                         const void *const *indices, int drawCount);
+// indirect 为命令数组, stride 为0时紧密排列, 索引来自绑定的 element buffer
+void glMultiDrawElementsIndirect(int mode, int dataType, const void *indirect,
+                                 int drawCount, int stride);
 inline FrameBuffer *glCreateFramebuffer() { return new FrameBuffer(); }
 inline RenderBuffer *glCreateRenderbuffer() { return new RenderBuffer(); }
 inline void glBindFramebuffer(int location, FrameBuffer *buffer) {
-  GLOBAL::GLOBAL_STATE->FRAMEBUFFER_BINDING = buffer;
+  auto state = GLOBAL::GLOBAL_STATE;
+  if (location == GL_FRAMEBUFFER || location == GL_DRAW_FRAMEBUFFER)
+    state->FRAMEBUFFER_BINDING = buffer;
+  if (location == GL_FRAMEBUFFER || location == GL_READ_FRAMEBUFFER)
+    state->READ_FRAMEBUFFER_BINDING = buffer;
 }
 inline void glBindRenderbuffer(int location, RenderBuffer *buffer) {
   GLOBAL::GLOBAL_STATE->RENDERBUFFER_BINDING = buffer;
 }
+/**
+ * @brief 绑定后每次绘制累加深度测试、fragment shader 执行次数和耗时,
+ * 尺寸跟随 viewport, 需要时由调用方 clear, 传 nullptr 关闭
+ */
+inline void glBindHeatmap(Heatmap *heatmap) {
+  GLOBAL::GLOBAL_STATE->HEATMAP_BINDING = heatmap;
+}
+inline Query *glCreateQuery() { return new Query(); }
+void glDeleteQuery(Query *query);
+void glBeginQuery(int target, Query *query);
+void glEndQuery(int target);
+inline void glGetQueryObjectui64v(Query *query, int pname, uint64_t *params) {
+  if (pname == GL_QUERY_RESULT_AVAILABLE)
+    *params = query->available;
+  // pipeline statistics 的结果由 glGetQueryPipelineStatistics 读取
+  if (pname == GL_QUERY_RESULT && query->available &&
+      query->target != GL_PIPELINE_STATISTICS)
+    *params = query->result;
+}
+inline void glGetQueryObjectuiv(Query *query, int pname, uint32_t *params) {
+  uint64_t value = *params;
+  glGetQueryObjectui64v(query, pname, &value);
+  *params = (uint32_t)std::min<uint64_t>(value, UINT32_MAX);
+}
+/**
+ * @brief query 需为 GL_SAMPLES_PASSED/GL_ANY_SAMPLES_PASSED, 结果在
+ * glEndQuery 时已确定, 所以 mode 不影响行为
+ */
+inline void glBeginConditionalRender(Query *query, int mode) {
+  if (query->target == GL_SAMPLES_PASSED ||
+      query->target == GL_ANY_SAMPLES_PASSED)
+    GLOBAL::GLOBAL_STATE->CONDITIONAL_RENDER_QUERY = query;
+}
+inline void glEndConditionalRender() {
+  GLOBAL::GLOBAL_STATE->CONDITIONAL_RENDER_QUERY = nullptr;
+}
+inline void glGetQueryPipelineStatistics(Query *query,
+                                         PipelineStatistics *statistics) {
+  if (query->available && query->target == GL_PIPELINE_STATISTICS)
+    *statistics = query->statistics;
+}
 
 void glLinkProgram(Program *program);
 void glTexImage2D(int location, int mipLevel, int internalFormat, int width,
                   int height, int border, int format, int dataType,
                   const void *data);
+// 文件中 offset 处需为与 format/dataType 一致的未压缩像素数据,
+// 长度按 Helper::texelSize 计算, 不支持的组合或文件过短时返回 false
+bool glTexImage2DFromFile(int location, int mipLevel, int internalFormat,
+                          int width, int height, int border, int format,
+                          int dataType, const char *path, size_t offset,
+                          FileAdvice advice = FileAdvice::NORMAL);
 void glClear(int mask);
 void glUniform1i(int location, int value);
 void glUniform1f(int location, float value);
@@ -197,4 +471,19 @@ void glFramebufferRenderbuffer(int target, int attachment,
                                RenderBuffer *renderbuffer);
 void glRenderbufferStorage(int target, int internalFormat, int width,
                            int height);
+/**
+ * @brief samples 大于1时分配 4x 多重采样存储, 颜色支持 GL_RGBA8/GL_RGBA32F,
+ * 同一 framebuffer 的颜色、深度和 stencil 附件 samples 不一致时不绘制
+ */
+void glRenderbufferStorageMultisample(int target, int samples,
+                                      int internalFormat, int width,
+                                      int height);
+/**
+ * @brief 从 READ_FRAMEBUFFER 拷贝到 DRAW_FRAMEBUFFER, 多重采样的源会被 resolve,
+ * 此时源和目标区域大小需一致; 缩放只支持最近邻采样.
+ * 不支持的情况直接忽略: 缩放的 resolve, 单采样到多重采样,
+ * samples 不同的多重采样之间
+ */
+void glBlitFramebuffer(int srcX0, int srcY0, int srcX1, int srcY1, int dstX0,
+                       int dstY0, int dstX1, int dstY1, int mask, int filter);
 } // namespace CppGL
\ No newline at end of file
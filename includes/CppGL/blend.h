@@ -0,0 +1,32 @@
+#pragma once
+
+#include "data-type.h"
+#include "math.h"
+
+namespace CppGL {
+struct GlobalState;
+
+/**
+ * @brief 对一批fragment做混合, 结果写回dst
+ * 每种 (src, dst, equation) 组合都会实例化一个kernel, 绘制前查表选好,
+ * 逐像素不再有 switch
+ */
+using BlendKernel = void (*)(const vec4 *src, vec4 *dst, int count,
+                             vec4 blendColor);
+
+BlendKernel getBlendKernel(BlendFunc src, BlendFunc dst, BlendEquation eq);
+
+/**
+ * @brief 一次绘制内不变的混合状态, rgb/alpha 参数不同时走两个kernel
+ */
+struct BlendState {
+  bool enabled = false;
+  bool separate = false;
+  BlendKernel rgb = nullptr;
+  BlendKernel alpha = nullptr;
+  vec4 color;
+
+  static BlendState from(const GlobalState *state);
+  void apply(const vec4 *src, vec4 *dst, int count) const;
+};
+} // namespace CppGL
@@ -1,14 +1,45 @@
 #pragma once
 
+#include <memory>
 #include <vector>
 namespace CppGL {
 struct Texture;
+struct MappedFile;
 struct Buffer {
   const void *data;
   int length;
+  // glBufferData 分配的存储, 由库持有, 起始地址64字节对齐
+  void *store = nullptr;
+  int capacity = 0;
+  // glMapBufferRange 映射的区间, 未映射时 mapAccess 为0
+  int mapOffset = 0;
+  int mapLength = 0;
+  int mapAccess = 0;
+  // 数据来自文件映射时持有映射, 此时只读, 不能 SubData/Map
+  std::shared_ptr<MappedFile> mapping;
+
+  /**
+   * @brief 确保存储至少有 length 字节并让 data 指向它, 容量足够时复用原存储,
+   * 旧内容不保留
+   */
+  void *reserve(int length);
+  void release();
+};
+
+/**
+ * @brief glBindBufferRange 绑定的区间, size 为0表示整个 buffer
+ */
+struct BufferRange {
+  Buffer *buffer = nullptr;
+  int offset = 0;
+  int size = 0;
 };
 
-enum AttachmentType { COLOR_ATTACHMENT0, DEPTH_ATTACHMENT };
+enum AttachmentType {
+  COLOR_ATTACHMENT0,
+  DEPTH_ATTACHMENT,
+  STENCIL_ATTACHMENT
+};
 struct AttachmentInfo {
   AttachmentType type;
   int level;
@@ -18,12 +49,14 @@ struct AttachmentInfo {
 struct FrameBuffer {
   AttachmentInfo COLOR_ATTACHMENT0;
   AttachmentInfo DEPTH_ATTACHMENT;
+  AttachmentInfo STENCIL_ATTACHMENT;
 };
 
 struct RenderBuffer {
   int width;
   int height;
   int format;
+  int samples = 0;
   Texture *attachment;
 };
 } // namespace CppGL
\ No newline at end of file
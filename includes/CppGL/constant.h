@@ -41,6 +41,89 @@ const int GL_COLOR_ATTACHMENT0 = 33;
 const int GL_DEPTH_COMPONENT16 = 34;
 const int GL_RGB = 35;
 const int GL_REPEAT = 36;
+const int GL_BLEND = 37;
+const int GL_ZERO = 38;
+const int GL_ONE = 39;
+const int GL_SRC_COLOR = 40;
+const int GL_ONE_MINUS_SRC_COLOR = 41;
+const int GL_DST_COLOR = 42;
+const int GL_ONE_MINUS_DST_COLOR = 43;
+const int GL_SRC_ALPHA = 44;
+const int GL_ONE_MINUS_SRC_ALPHA = 45;
+const int GL_DST_ALPHA = 46;
+const int GL_ONE_MINUS_DST_ALPHA = 47;
+const int GL_CONSTANT_COLOR = 48;
+const int GL_ONE_MINUS_CONSTANT_COLOR = 49;
+const int GL_CONSTANT_ALPHA = 50;
+const int GL_ONE_MINUS_CONSTANT_ALPHA = 51;
+const int GL_SRC_ALPHA_SATURATE = 52;
+const int GL_FUNC_ADD = 53;
+const int GL_FUNC_SUBTRACT = 54;
+const int GL_FUNC_REVERSE_SUBTRACT = 55;
+const int GL_MIN = 56;
+const int GL_MAX = 57;
+const int GL_STENCIL_BUFFER_BIT = 4;
+const int GL_STENCIL_TEST = 58;
+const int GL_STENCIL_ATTACHMENT = 59;
+const int GL_STENCIL_INDEX8 = 60;
+const int GL_NEVER = 61;
+const int GL_LESS = 62;
+const int GL_EQUAL = 63;
+const int GL_LEQUAL = 64;
+const int GL_GREATER = 65;
+const int GL_NOTEQUAL = 66;
+const int GL_GEQUAL = 67;
+const int GL_ALWAYS = 68;
+const int GL_KEEP = 69;
+const int GL_REPLACE = 70;
+const int GL_INCR = 71;
+const int GL_INCR_WRAP = 72;
+const int GL_DECR = 73;
+const int GL_DECR_WRAP = 74;
+const int GL_INVERT = 75;
+const int GL_FRONT = 76;
+const int GL_BACK = 77;
+const int GL_FRONT_AND_BACK = 78;
+const int GL_SCISSOR_TEST = 79;
+const int GL_BYTE = 80;
+const int GL_SHORT = 81;
+const int GL_HALF_FLOAT = 82;
+const int GL_INT_2_10_10_10_REV = 83;
+const int GL_UNSIGNED_INT_2_10_10_10_REV = 84;
+const int GL_DYNAMIC_DRAW = 85;
+const int GL_STREAM_DRAW = 86;
+const int GL_TRIANGLE_STRIP = 87;
+const int GL_TRIANGLE_FAN = 88;
+const int GL_PRIMITIVE_RESTART_FIXED_INDEX = 89;
+const int GL_POINTS = 90;
+const int GL_LINES = 91;
+const int GL_LINE_STRIP = 92;
+const int GL_LINE_LOOP = 93;
+const int GL_UNSIGNED_INT = 94;
+const int GL_UNIFORM_BUFFER = 95;
+// glGetUniformBlockIndex 找不到 block 时的返回值
+const int GL_INVALID_INDEX = -1;
+const int GL_RGBA8 = 96;
+const int GL_RGBA32F = 97;
+const int GL_READ_FRAMEBUFFER = 98;
+const int GL_DRAW_FRAMEBUFFER = 99;
+const int GL_TIME_ELAPSED = 100;
+const int GL_SAMPLES_PASSED = 101;
+const int GL_ANY_SAMPLES_PASSED = 102;
+// 一个 query 同时统计 PipelineStatistics 的所有计数
+const int GL_PIPELINE_STATISTICS = 103;
+const int GL_QUERY_RESULT = 104;
+const int GL_QUERY_RESULT_AVAILABLE = 105;
+// 绘制是同步的, 条件渲染的各种 mode 行为相同
+const int GL_QUERY_WAIT = 106;
+const int GL_QUERY_NO_WAIT = 107;
+const int GL_QUERY_BY_REGION_WAIT = 108;
+const int GL_QUERY_BY_REGION_NO_WAIT = 109;
+// glMapBufferRange access, 按位组合
+const int GL_MAP_READ_BIT = 1;
+const int GL_MAP_WRITE_BIT = 2;
+const int GL_MAP_INVALIDATE_RANGE_BIT = 4;
+const int GL_MAP_INVALIDATE_BUFFER_BIT = 8;
 const bool GL_FALSE = false;
 const bool GL_TRUE = true;
 const auto GL_VERTEX_SHADER = Shader::VERTEX_SHADER;
@@ -1,14 +1,68 @@
 #pragma once
 
+#include "constant.h"
+
 namespace CppGL {
 
 enum DepthFunc {};
-enum BlendFunc {};
-enum BlendEquation {};
-enum StencilFunc {};
-enum StencilAction { KEEP };
+// 取值与对应的 GL_XXX 常量一致, 可直接由 int 转换
+enum class BlendFunc {
+  ZERO = GL_ZERO,
+  ONE = GL_ONE,
+  SRC_COLOR = GL_SRC_COLOR,
+  ONE_MINUS_SRC_COLOR = GL_ONE_MINUS_SRC_COLOR,
+  DST_COLOR = GL_DST_COLOR,
+  ONE_MINUS_DST_COLOR = GL_ONE_MINUS_DST_COLOR,
+  SRC_ALPHA = GL_SRC_ALPHA,
+  ONE_MINUS_SRC_ALPHA = GL_ONE_MINUS_SRC_ALPHA,
+  DST_ALPHA = GL_DST_ALPHA,
+  ONE_MINUS_DST_ALPHA = GL_ONE_MINUS_DST_ALPHA,
+  CONSTANT_COLOR = GL_CONSTANT_COLOR,
+  ONE_MINUS_CONSTANT_COLOR = GL_ONE_MINUS_CONSTANT_COLOR,
+  CONSTANT_ALPHA = GL_CONSTANT_ALPHA,
+  ONE_MINUS_CONSTANT_ALPHA = GL_ONE_MINUS_CONSTANT_ALPHA,
+  SRC_ALPHA_SATURATE = GL_SRC_ALPHA_SATURATE,
+};
+enum class BlendEquation {
+  FUNC_ADD = GL_FUNC_ADD,
+  FUNC_SUBTRACT = GL_FUNC_SUBTRACT,
+  FUNC_REVERSE_SUBTRACT = GL_FUNC_REVERSE_SUBTRACT,
+  MIN = GL_MIN,
+  MAX = GL_MAX,
+};
+enum class StencilFunc {
+  NEVER = GL_NEVER,
+  LESS = GL_LESS,
+  EQUAL = GL_EQUAL,
+  LEQUAL = GL_LEQUAL,
+  GREATER = GL_GREATER,
+  NOTEQUAL = GL_NOTEQUAL,
+  GEQUAL = GL_GEQUAL,
+  ALWAYS = GL_ALWAYS,
+};
+enum class StencilAction {
+  KEEP = GL_KEEP,
+  ZERO = GL_ZERO,
+  REPLACE = GL_REPLACE,
+  INCR = GL_INCR,
+  INCR_WRAP = GL_INCR_WRAP,
+  DECR = GL_DECR,
+  DECR_WRAP = GL_DECR_WRAP,
+  INVERT = GL_INVERT,
+};
 enum CullFaceMode { BACK };
 enum FrontFace { CCW };
-enum ShaderSourceMeta { Attribute, Uniform, Varying };
+enum ShaderSourceMeta { Attribute, Uniform, Varying, UniformBlock };
+
+/**
+ * @brief glMultiDrawElementsIndirect 的命令, 字段顺序与 GL 一致
+ */
+struct DrawElementsIndirectCommand {
+  unsigned int count;
+  unsigned int instanceCount;
+  unsigned int firstIndex;
+  int baseVertex;
+  unsigned int baseInstance;
+};
 
-} // namespace CppGL
\ No newline at end of file
+} // namespace CppGL
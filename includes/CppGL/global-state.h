@@ -11,6 +11,8 @@ namespace CppGL {
 struct Program;
 struct Buffer;
 struct VertexArray;
+struct Query;
+struct Heatmap;
 
 struct GlobalState {
   // common state
@@ -19,12 +21,29 @@ struct GlobalState {
   Program *CURRENT_PROGRAM = nullptr;
   VertexArray *VERTEX_ARRAY_BINDING = nullptr;
   RenderBuffer *RENDERBUFFER_BINDING = nullptr;
+  // 绘制使用的 framebuffer, 即 DRAW_FRAMEBUFFER_BINDING
   FrameBuffer *FRAMEBUFFER_BINDING = nullptr;
+  FrameBuffer *READ_FRAMEBUFFER_BINDING = nullptr;
   int ACTIVE_TEXTURE = GL_TEXTURE0;
 
   // texture units
   std::vector<TextureUnit> textureUints{10};
 
+  // uniform buffer state, 绑定点由所有 program 共用
+  Buffer *UNIFORM_BUFFER_BINDING = nullptr;
+  std::vector<BufferRange> uniformBufferBindings{24};
+
+  // query state, 每个 target 同时只有一个活动的 query
+  Query *CURRENT_TIME_ELAPSED_QUERY = nullptr;
+  Query *CURRENT_SAMPLES_PASSED_QUERY = nullptr;
+  Query *CURRENT_ANY_SAMPLES_PASSED_QUERY = nullptr;
+  Query *CURRENT_PIPELINE_STATISTICS_QUERY = nullptr;
+  // glBeginConditionalRender 指定的 query, 结果为0时跳过绘制和清理
+  Query *CONDITIONAL_RENDER_QUERY = nullptr;
+
+  // debug state, 不为空时绘制同时累加逐像素计数
+  Heatmap *HEATMAP_BINDING = nullptr;
+
   // clear state
   vec4 COLOR_CLEAR_VALUE;
   float DEPATH_CLEAR_VALUE = 1;
@@ -38,34 +57,36 @@ struct GlobalState {
 
   // blend state
   bool BLEND = false;
-  BlendFunc BLEND_DST_RGB;
-  BlendFunc BLEND_SRC_RGB;
-  BlendFunc BLEND_DST_ALPHA;
-  BlendFunc BLEND_SRC_ALPHA;
-  vec4 BLEND_COLOR;
-  BlendEquation BLEND_EQUATION_RGB;
-  BlendEquation BLEND_EQUATION_ALPHA;
+  BlendFunc BLEND_DST_RGB = BlendFunc::ZERO;
+  BlendFunc BLEND_SRC_RGB = BlendFunc::ONE;
+  BlendFunc BLEND_DST_ALPHA = BlendFunc::ZERO;
+  BlendFunc BLEND_SRC_ALPHA = BlendFunc::ONE;
+  vec4 BLEND_COLOR{0, 0, 0, 0};
+  BlendEquation BLEND_EQUATION_RGB = BlendEquation::FUNC_ADD;
+  BlendEquation BLEND_EQUATION_ALPHA = BlendEquation::FUNC_ADD;
 
   // misc state
-  int COLOR_WRITEMASK;
-  bool SCISSOR_TEST;
-  vec4 SCISSOR_BOX;
+  // 按位 r=1 g=2 b=4 a=8
+  int COLOR_WRITEMASK = 0xf;
+  bool SCISSOR_TEST = false;
+  vec4 SCISSOR_BOX{0, 0, 300, 150};
+  bool PRIMITIVE_RESTART_FIXED_INDEX = false;
   int UNPACK_ALIGNMENT = 4;
   int PACK_ALIGNMENT = 4;
 
   // stencil state
   bool STENCIL_TEST = false;
-  StencilFunc STENCIL_FUNC;
-  StencilAction STENCIL_FAIL;
-  StencilAction STENCIL_PASS_DEPTH_FAIL;
-  StencilAction STENCIL_PASS_DEPTH_PASS;
+  StencilFunc STENCIL_FUNC = StencilFunc::ALWAYS;
+  StencilAction STENCIL_FAIL = StencilAction::KEEP;
+  StencilAction STENCIL_PASS_DEPTH_FAIL = StencilAction::KEEP;
+  StencilAction STENCIL_PASS_DEPTH_PASS = StencilAction::KEEP;
   int STENCIL_REF = 0x00;
   int STENCIL_VALUE_MASK = 0xff;
   int STENCIL_WRITE_MASK = 0xff;
-  StencilFunc STENCIL_BACK_FUNC;
-  StencilAction STENCIL_BACK_FAIL;
-  StencilAction STENCIL_BACK_PASS_DEPTH_FAIL;
-  StencilAction STENCIL_BACK_PASS_DEPTH_PASS;
+  StencilFunc STENCIL_BACK_FUNC = StencilFunc::ALWAYS;
+  StencilAction STENCIL_BACK_FAIL = StencilAction::KEEP;
+  StencilAction STENCIL_BACK_PASS_DEPTH_FAIL = StencilAction::KEEP;
+  StencilAction STENCIL_BACK_PASS_DEPTH_PASS = StencilAction::KEEP;
   int STENCIL_BACK_REF = 0x00;
   int STENCIL_BACK_VALUE_MASK = 0xff;
   int STENCIL_BACK_WRITE_MASK = 0xff;
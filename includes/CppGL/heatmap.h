@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#endif
+
+namespace CppGL {
+/**
+ * @brief 调试用的逐像素计数, 由 glBindHeatmap 绑定后每次绘制累加,
+ * 与颜色附件同时写入, 下标与 framebuffer 相同 (x + y * width)
+ */
+struct Heatmap {
+  enum Channel {
+    // 进入 stencil/深度测试的次数, 即 overdraw, 多重采样时每个 sample 算一次
+    DEPTH_TESTS,
+    FRAGMENT_SHADER_INVOCATIONS,
+    // fragment shader main 的耗时, x86 上为 TSC 周期, 其他平台为纳秒
+    FRAGMENT_SHADER_CYCLES,
+  };
+
+  int width = 0;
+  int height = 0;
+  std::vector<uint32_t> depthTests{};
+  std::vector<uint32_t> shaderInvocations{};
+  std::vector<uint64_t> shaderCycles{};
+
+  // 尺寸变化时重新分配并清零
+  void resize(int width, int height);
+  void clear();
+  uint64_t value(Channel channel, int index) const;
+  uint64_t max(Channel channel) const;
+  /**
+   * @brief 按 黑-蓝-绿-黄-红 的色带写入 RGBA8 图像, 行序与 framebuffer 相同,
+   * maxValue 为0时以该通道的最大值归一化
+   */
+  void toImage(Channel channel, uint8_t *rgba, uint64_t maxValue = 0) const;
+};
+
+inline uint64_t readCycleCounter() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) ||          \
+    defined(_M_IX86)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
+} // namespace CppGL
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+namespace CppGL {
+/**
+ * @brief 渲染内部的任务系统, 常驻的 worker 线程各有一个任务队列,
+ * 从自己队列的尾部取任务, 空了就从其他队列的头部窃取;
+ * 发起并行的线程也参与执行直到这一批全部完成, 任务内再次并行不会死锁
+ */
+namespace Jobs {
+/**
+ * @brief 参与并行的线程数, 包括发起并行的线程, 默认为硬件线程数,
+ * 为1时所有任务在调用线程上顺序执行; 修改后下次并行时重建 worker,
+ * 不能在并行执行期间调用
+ */
+void setThreadCount(int count);
+int threadCount();
+/**
+ * @brief worker i (1 <= i < threadCount) 绑定到 cpus[(i - 1) % cpus.size()],
+ * 为空时不绑定; 发起并行的线程属于应用, 不绑定. 只在 Linux 上生效
+ */
+void setAffinity(const std::vector<int> &cpus);
+/**
+ * @brief 按 NUMA 节点绑定 worker: 读取 /sys/devices/system/node 的拓扑,
+ * 下标相邻的 worker 分在同一个节点, 节点按下标顺序分配, 开启后忽略
+ * setAffinity 的设置; 渲染器同时把屏幕按 tile 行固定分给各 worker,
+ * 见 Helper::forEachTileRow. 调用线程 (worker 0) 不由渲染器绑定,
+ * 需要时由应用绑定到第一个节点; 读不到拓扑时 (非 Linux) 只固定归属
+ */
+void setNumaAffinity(bool enabled);
+bool numaAffinity();
+// 读到的 NUMA 节点数, 读不到时为1
+int nodeCount();
+// 当前线程的 worker 下标, 不是 worker 的线程为0
+int workerIndex();
+/**
+ * @brief 把 [0, count) 切成长度不超过 grain 的区间, 并行执行 job(begin, end),
+ * 全部完成后返回
+ */
+void parallelFor(int count, int grain,
+                 const std::function<void(int begin, int end)> &job);
+/**
+ * @brief 对 [0, count) 的每个下标执行 job(index), 下标按连续区段依次分给
+ * worker 0 到 threadCount - 1, count 和线程数不变时归属不变, 不会被窃取
+ */
+void parallelForOwned(int count, const std::function<void(int index)> &job);
+} // namespace Jobs
+} // namespace CppGL
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace CppGL {
+/**
+ * @brief 传给 madvise 的访问模式提示
+ */
+enum class FileAdvice { NORMAL, SEQUENTIAL, RANDOM };
+
+/**
+ * @brief 只读映射整个文件, 同一路径在仍被引用时共用一份映射,
+ * 多个进程映射同一文件时共享系统的 page cache
+ */
+struct MappedFile {
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+  // 析构时从打开表中移除
+  std::string path{};
+
+  ~MappedFile();
+  // 打开失败或文件为空时返回 nullptr
+  static std::shared_ptr<MappedFile> open(const std::string &path);
+  void advise(size_t offset, size_t length, FileAdvice advice) const;
+};
+} // namespace CppGL
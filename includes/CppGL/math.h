@@ -321,11 +321,15 @@ struct triangle {
     return {a / v.x, b / v.y, c / v.z};
   }
   inline box2 viewportBoundingBox(vec4 viewport) {
+    return viewportBoundingBox(box2{{0, 0}, {viewport.z, viewport.w}});
+  }
+  // clipBox 为 viewport 与 scissor 的交集
+  inline box2 viewportBoundingBox(box2 clipBox) {
     box2 boundingBox;
     boundingBox.expandByPoint({a.x, a.y});
     boundingBox.expandByPoint({b.x, b.y});
     boundingBox.expandByPoint({c.x, c.y});
-    boundingBox.clamp({{0, 0}, {viewport.z, viewport.w}});
+    boundingBox.clamp(clipBox);
     return boundingBox;
   }
 
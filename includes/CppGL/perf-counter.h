@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+namespace CppGL {
+/**
+ * @brief Helper::draw 中可单独计数的阶段, 切换阶段要读一次计数器,
+ * 所以按 tile 而不是按 fragment 划分: FRAGMENT 为 tile 内的遍历、
+ * fragment shader、深度/stencil 写入和混合, RASTER 为三角形 setup 和分箱
+ */
+enum class PerfStage { VERTEX, RASTER, FRAGMENT, COUNT, NONE = COUNT };
+
+struct PerfCounterValues {
+  uint64_t cycles = 0;
+  uint64_t instructions = 0;
+  uint64_t l1dMisses = 0;
+  uint64_t llcMisses = 0;
+  uint64_t branchMisses = 0;
+
+  PerfCounterValues &operator+=(const PerfCounterValues &other);
+};
+
+struct PerfFrame {
+  PerfCounterValues stages[(int)PerfStage::COUNT];
+};
+
+/**
+ * @brief 基于 perf_event_open 的硬件计数器, 只在 Linux 上可用,
+ * 其他平台 enable 返回 false, 其余调用为空操作
+ * 每个线程第一次进入阶段时打开自己的计数器组, 只统计本线程
+ */
+namespace Perf {
+// 内核不允许或硬件不支持时返回 false
+bool enable();
+void disable();
+bool enabled();
+/**
+ * @brief 合并所有线程自上次调用以来各阶段的计数并清零, 需在帧之间调用
+ */
+PerfFrame endFrame();
+
+/**
+ * @brief 进入阶段, 离开作用域时回到之前的阶段, 嵌套时只计入最内层
+ */
+struct StageScope {
+  PerfStage previous = PerfStage::NONE;
+  bool active = false;
+
+  explicit StageScope(PerfStage stage);
+  ~StageScope() { end(); }
+  // 提前离开阶段
+  void end();
+};
+} // namespace Perf
+} // namespace CppGL
@@ -2,6 +2,7 @@
 
 #include "math.h"
 #include "rttr/string_view.h"
+#include "rttr/type.h"
 #include "shader.h"
 #include <vector>
 
@@ -14,10 +15,54 @@ struct Program {
     rttr::string_view name;
   };
 
+  /**
+   * @brief block 中一个成员从 std140 布局到 C++ 布局的拷贝,
+   * 共 count 段, 每段 size 字节, 两边相邻段的间隔分别为
+   * bufferStride/dataStride; 数组和 mat3 的列按段拆开
+   */
+  struct Std140Copy {
+    size_t bufferOffset;
+    size_t dataOffset;
+    size_t size;
+    size_t count;
+    size_t bufferStride;
+    size_t dataStride;
+  };
+
+  /**
+   * @brief uniform block 在两个 shader 中的存储, 未声明该 block 的一侧为空,
+   * 链接时解析好; block struct 的成员用 CPPGL_RTTR_PROP 注册时 layout
+   * 为逐成员的 std140 拷贝, size 为 std140 布局的字节数, 否则 layout 为空,
+   * 按 C++ 布局从绑定的 buffer 整块拷贝
+   */
+  struct UniformBlockInfo {
+    rttr::string_view name;
+    size_t size;
+    int binding = 0;
+    uint8_t *vertexData = nullptr;
+    uint8_t *fragmentData = nullptr;
+    std::vector<Std140Copy> layout{};
+  };
+
+  /**
+   * @brief uniform 在两个 shader 中的存储及声明的类型, 未声明的一侧为空
+   */
+  struct UniformSlot {
+    // 数组 uniform 为元素类型, size 为整个成员的字节数
+    rttr::type type;
+    size_t size = 0;
+    uint8_t *vertexData = nullptr;
+    uint8_t *fragmentData = nullptr;
+  };
+
   Shader *vertexShader = nullptr;
   Shader *fragmentShader = nullptr;
   std::map<rttr::string_view, DataInfo> unifroms{};
   std::map<rttr::string_view, DataInfo> attributes{};
+  // 下标即 uniform 的 location, 链接时建立
+  std::vector<UniformSlot> uniformSlots{};
+  // 下标即 glGetUniformBlockIndex 的返回值
+  std::vector<UniformBlockInfo> uniformBlocks{};
   // std::map<rttr::string_view, DataInfo> varyings{};
 };
 
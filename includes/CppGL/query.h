@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace CppGL {
+/**
+ * @brief 管线统计计数, tested/depthRejected/written 以 sample 为单位,
+ * 单采样时即像素数; discarded 以 fragment shader 执行次数为单位
+ */
+struct PipelineStatistics {
+  uint64_t verticesShaded = 0;
+  uint64_t primitivesSubmitted = 0;
+  // 部分落在 viewport/scissor 之外, 光栅化范围被收窄的图元
+  uint64_t primitivesClipped = 0;
+  // 完全不产生 fragment 的图元: 在 viewport/scissor 之外, 退化或 w <= 0
+  uint64_t primitivesCulled = 0;
+  uint64_t pixelsTested = 0;
+  uint64_t pixelsDepthRejected = 0;
+  uint64_t pixelsDiscarded = 0;
+  uint64_t pixelsWritten = 0;
+  // fragment shader 执行次数, 多重采样时每个像素一次
+  uint64_t fragmentShaderInvocations = 0;
+
+  PipelineStatistics &operator+=(const PipelineStatistics &other);
+  PipelineStatistics operator-(const PipelineStatistics &other) const;
+};
+
+/**
+ * @brief 绘制是同步执行的, glEndQuery 返回时结果已经可用
+ */
+struct Query {
+  int target = 0;
+  bool active = false;
+  bool available = false;
+  std::chrono::steady_clock::time_point beginTime;
+  // glBeginQuery 时所有线程计数之和, 结束时相减得到区间内的计数
+  PipelineStatistics beginStatistics;
+  PipelineStatistics statistics;
+  // GL_TIME_ELAPSED 为纳秒, GL_SAMPLES_PASSED 为 sample 数
+  uint64_t result = 0;
+};
+
+namespace Helper {
+/**
+ * @brief 当前线程的计数, 只由本线程写, 绘制时不需要同步
+ */
+PipelineStatistics &threadStatistics();
+/**
+ * @brief 合并所有线程的计数, 包括已退出的线程, 需在没有绘制进行时调用
+ */
+PipelineStatistics mergeStatistics();
+} // namespace Helper
+} // namespace CppGL
@@ -2,6 +2,7 @@
 
 #include <rttr/registration>
 #include <rttr/type>
+#include <type_traits>
 
 #define CPPGL_RTTR_REGISTRATION                                                   \
   static void RTTR_CAT(rttr_auto_register_reflection_function_, __LINE__)();   \
@@ -16,5 +17,14 @@
       RTTR_CAT(auto_register__, __LINE__);                                     \
   static void RTTR_CAT(rttr_auto_register_reflection_function_, __LINE__)()
 
+/**
+ * @brief metadata 0 为变量类型, 1 为字节数, 2 为拷贝所属 shader 的
+ * ShaderCopyOps, 见 shader.h, 3 为元素类型(数组去掉维度, 其余同成员类型)
+ */
 #define CPPGL_RTTR_PROP(_x_, _t_)                                                 \
-  property(#_x_, &S::_x_)(metadata(0, _t_), metadata(1, sizeof(S::_x_)), policy::prop::bind_as_ptr)
\ No newline at end of file
+  property(#_x_, &S::_x_)(metadata(0, _t_), metadata(1, sizeof(S::_x_)),       \
+                          metadata(2, ::CppGL::ShaderCopyOps::of<S>()),        \
+                          metadata(3, ::rttr::type::get<                       \
+                                          std::remove_all_extents_t<           \
+                                              decltype(S::_x_)>>()),           \
+                          policy::prop::bind_as_ptr)
\ No newline at end of file
@@ -2,10 +2,13 @@
 
 #include "math.h"
 #include <cmath>
+#include <cstddef>
 #include <functional>
 #include <map>
+#include <new>
 #include <rttr/registration>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 namespace CppGL {
@@ -31,7 +34,10 @@ typedef int sample2D;
 
 struct ShaderSource {
   vec4 gl_Position;
+  float gl_PointSize = 1;
   vec4 gl_FragColor;
+  vec2 gl_PointCoord;
+  int gl_InstanceID = 0;
   bool _discarded = false;
   inline void DISCARD() { _discarded = true; }
   static vec4 texture2D(sample2D textureUint, vec2 uv);
@@ -56,6 +62,48 @@ struct ShaderSource {
   RTTR_ENABLE()
 };
 
+/**
+ * @brief 多线程绘制时每个 worker 使用 shader 的副本, 按实际类型拷贝构造,
+ * 之后每个 instance 拷贝赋值同步; 由 CPPGL_RTTR_PROP 登记, 所以 shader
+ * 需可拷贝构造和赋值, 副本的语义即拷贝构造函数的语义.
+ * 没有 CPPGL_RTTR_PROP 成员的 shader 取不到, 在调用线程上顺序绘制
+ */
+struct ShaderCopyOps {
+  size_t size;
+  ShaderSource *(*construct)(void *mem, const ShaderSource &src);
+  void (*assign)(ShaderSource *dst, const ShaderSource &src);
+  void (*destroy)(ShaderSource *shader);
+
+  // uniform block 等不是 shader 的 struct 也可用 CPPGL_RTTR_PROP 注册成员,
+  // 此时为空
+  template <typename S> static const ShaderCopyOps *of() {
+    if constexpr (!std::is_base_of_v<ShaderSource, S>)
+      return nullptr;
+    else
+      return shaderOps<S>();
+  }
+
+private:
+  template <typename S> static const ShaderCopyOps *shaderOps() {
+    static_assert(std::is_copy_constructible_v<S> &&
+                      std::is_copy_assignable_v<S>,
+                  "shader must be copy constructible and assignable");
+    static_assert(alignof(S) <= alignof(std::max_align_t),
+                  "shader alignment exceeds std::max_align_t");
+    static const ShaderCopyOps ops{
+        sizeof(S),
+        [](void *mem, const ShaderSource &src) -> ShaderSource * {
+          return new (mem) S(static_cast<const S &>(src));
+        },
+        [](ShaderSource *dst, const ShaderSource &src) {
+          static_cast<S &>(*dst) = static_cast<const S &>(src);
+        },
+        [](ShaderSource *shader) { static_cast<S *>(shader)->~S(); },
+    };
+    return &ops;
+  }
+};
+
 struct Shader {
   enum Type {
     VERTEX_SHADER,
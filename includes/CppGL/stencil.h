@@ -0,0 +1,94 @@
+#pragma once
+
+#include "data-type.h"
+#include "global-state.h"
+#include <cstdint>
+
+namespace CppGL {
+/**
+ * @brief 单个面(正/反)的stencil参数
+ */
+struct StencilFace {
+  StencilFunc func;
+  int ref;
+  int valueMask;
+  int writeMask;
+  StencilAction fail;
+  StencilAction depthFail;
+  StencilAction depthPass;
+
+  inline bool test(uint8_t value) const {
+    int a = ref & valueMask;
+    int b = value & valueMask;
+    switch (func) {
+    case StencilFunc::NEVER:
+      return false;
+    case StencilFunc::LESS:
+      return a < b;
+    case StencilFunc::EQUAL:
+      return a == b;
+    case StencilFunc::LEQUAL:
+      return a <= b;
+    case StencilFunc::GREATER:
+      return a > b;
+    case StencilFunc::NOTEQUAL:
+      return a != b;
+    case StencilFunc::GEQUAL:
+      return a >= b;
+    case StencilFunc::ALWAYS:
+      return true;
+    }
+    return true;
+  }
+
+  inline void update(StencilAction action, uint8_t &value) const {
+    int result = value;
+    switch (action) {
+    case StencilAction::KEEP:
+      return;
+    case StencilAction::ZERO:
+      result = 0;
+      break;
+    case StencilAction::REPLACE:
+      result = ref;
+      break;
+    case StencilAction::INCR:
+      result = std::min(value + 1, 0xff);
+      break;
+    case StencilAction::INCR_WRAP:
+      result = (value + 1) & 0xff;
+      break;
+    case StencilAction::DECR:
+      result = std::max(value - 1, 0);
+      break;
+    case StencilAction::DECR_WRAP:
+      result = (value - 1) & 0xff;
+      break;
+    case StencilAction::INVERT:
+      result = ~value;
+      break;
+    }
+    value = (uint8_t)((value & ~writeMask) | (result & writeMask));
+  }
+};
+
+/**
+ * @brief 一次绘制内不变的stencil状态
+ */
+struct StencilState {
+  bool enabled = false;
+  StencilFace front;
+  StencilFace back;
+
+  inline static StencilState from(const GlobalState *state) {
+    return {state->STENCIL_TEST,
+            {state->STENCIL_FUNC, state->STENCIL_REF, state->STENCIL_VALUE_MASK,
+             state->STENCIL_WRITE_MASK, state->STENCIL_FAIL,
+             state->STENCIL_PASS_DEPTH_FAIL, state->STENCIL_PASS_DEPTH_PASS},
+            {state->STENCIL_BACK_FUNC, state->STENCIL_BACK_REF,
+             state->STENCIL_BACK_VALUE_MASK, state->STENCIL_BACK_WRITE_MASK,
+             state->STENCIL_BACK_FAIL, state->STENCIL_BACK_PASS_DEPTH_FAIL,
+             state->STENCIL_BACK_PASS_DEPTH_PASS}};
+  }
+};
+} // namespace CppGL
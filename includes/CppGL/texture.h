@@ -4,6 +4,9 @@
 #include "constant.h"
 #include <vector>
 namespace CppGL {
+// 多重采样只支持 4x, 其他 samples 取值按 4x 处理
+const int MAX_SAMPLES = 4;
+
 struct TextureBuffer : Buffer {
   int width;
   int height;
@@ -11,6 +14,8 @@ struct TextureBuffer : Buffer {
   int border;
   int dataType;
   int internalFormat;
+  // 多重采样时同一像素的 sample 连续存放, 下标为 pixel * samples + sample
+  int samples = 1;
   TextureBuffer(const void *data, int length, int width, int height, int format,
                 int border, int dataType, int internalFormat)
       : Buffer{data, length}, width(width), height(height), format(format),
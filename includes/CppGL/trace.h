@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief 以 Chrome trace_event 格式记录各 gl* 调用和管线阶段的耗时,
+ * 结果可在 chrome://tracing 或 Perfetto 中打开
+ * 编译时定义 CPPGL_ENABLE_TRACE 才生效, 否则 CPPGL_TRACE* 展开为空
+ *
+ * CPPGL_TRACE("gl", "glClear");          // 到作用域结束为一个 span
+ * CPPGL_TRACE_BEGIN(setup, "pipeline", "setup");
+ * ...
+ * CPPGL_TRACE_END(setup);                // 不便用作用域时手动结束
+ */
+namespace CppGL::Trace {
+// 开始记录, 清空之前的记录
+void start();
+// 停止记录并把所有线程的 span 写入 path, 需在没有绘制进行时调用
+bool stop(const char *path);
+
+#ifdef CPPGL_ENABLE_TRACE
+/**
+ * @brief name/category 需为字符串字面量, 只保存指针
+ */
+struct Scope {
+  const char *category;
+  const char *name;
+  uint64_t begin;
+  bool ended = false;
+
+  Scope(const char *category, const char *name);
+  ~Scope() { end(); }
+  void end();
+};
+#endif
+} // namespace CppGL::Trace
+
+#ifdef CPPGL_ENABLE_TRACE
+#define CPPGL_TRACE_CONCAT_(a, b) a##b
+#define CPPGL_TRACE_CONCAT(a, b) CPPGL_TRACE_CONCAT_(a, b)
+#define CPPGL_TRACE(category, name)                                            \
+  ::CppGL::Trace::Scope CPPGL_TRACE_CONCAT(cppglTrace, __LINE__)(category, name)
+#define CPPGL_TRACE_BEGIN(id, category, name)                                  \
+  ::CppGL::Trace::Scope cppglTrace_##id(category, name)
+#define CPPGL_TRACE_END(id) cppglTrace_##id.end()
+#else
+#define CPPGL_TRACE(category, name)
+#define CPPGL_TRACE_BEGIN(id, category, name)
+#define CPPGL_TRACE_END(id)
+#endif
@@ -1,11 +1,16 @@
-
 #pragma once
 
 #include "constant.h"
 #include "buffer.h"
+#include <cstdint>
 #include <vector>
 
 namespace CppGL {
+/**
+ * @brief 读取一个元素的attribute, 转换为float写入dst
+ */
+using AttributeFetcher = void (*)(const uint8_t *src, float *dst);
+
 struct AttributeInfo {
   bool enabled = false;
   int size = 4;
@@ -15,10 +20,19 @@ struct AttributeInfo {
   int offset = 0;
   int divisor = 0;
   Buffer *buffer = nullptr;
+
+  // 由 VertexArray::compile 解析, fetch 为空表示参数不合法
+  AttributeFetcher fetch = nullptr;
+  int byteStride = 0;
 };
 
 struct VertexArray {
   std::vector<AttributeInfo> attributes{};
   Buffer *indexBuffer = nullptr;
+  // attribute 参数变化后置为 true, 绘制前重新 compile
+  bool dirty = true;
+
+  AttributeInfo &attribute(int location);
+  void compile();
 };
-} // namespace CppGL
\ No newline at end of file
+} // namespace CppGL
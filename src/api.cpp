@@ -4,12 +4,63 @@
 
 namespace CppGL {
 
+/**
+ * @brief 按 std140 规则排列 block struct 注册的成员, 返回 std140 布局的
+ * 字节数; 标量对齐4, vec2 对齐8, 其余对齐16, 数组元素和 mat3 的列间隔
+ * 向上取整到16; 没有注册成员时返回0
+ */
+static size_t std140Layout(rttr::type blockType, rttr::variant &block,
+                           std::vector<Program::Std140Copy> &layout) {
+  layout.clear();
+  auto data = block.get_value<uint8_t *>();
+  rttr::instance instance(block);
+  size_t offset = 0;
+  for (auto &prop : blockType.get_properties()) {
+    auto element = prop.get_metadata(3).get_value<rttr::type>();
+    auto memberSize = prop.get_metadata(1).get_value<size_t>();
+    auto member = prop.get_value(instance).get_value<uint8_t *>();
+    // 不是 CPPGL_RTTR_PROP 注册的成员取不到地址, 整个 block 按 C++ 布局
+    if (member == nullptr) {
+      layout.clear();
+      return 0;
+    }
+    bool isArray = prop.get_type().get_raw_type().is_array();
+    size_t size = element.get_sizeof();
+    size_t count = memberSize / size;
+    size_t align = 16;
+    if (element == rttr::type::get<mat3>()) {
+      // mat3 按 3 列 vec3 存储, 每列占 16 字节
+      size = sizeof(vec3);
+      count *= 3;
+      isArray = true;
+    } else if (element.is_arithmetic()) {
+      align = 4;
+    } else if (element == rttr::type::get<vec2>()) {
+      align = 8;
+    }
+    size_t stride = isArray ? (size + 15) / 16 * 16 : size;
+    if (isArray)
+      align = 16;
+    offset = (offset + align - 1) / align * align;
+    layout.push_back({offset, (size_t)(member - data), size, count, stride,
+                      size});
+    offset += isArray ? stride * count : size;
+  }
+  return layout.empty() ? 0 : offset;
+}
+
 void glLinkProgram(Program *program) {
+  CPPGL_TRACE("gl", "glLinkProgram");
   // 收集shader上的attribute uniform varying 信息到program里
   int attributeIndex = 0;
   int uniformIndex = 0;
   int varyingIndex = 0;
-  auto processTypeInfo = [&](rttr::type &&type) {
+  program->unifroms.clear();
+  program->attributes.clear();
+  program->uniformSlots.clear();
+  program->uniformBlocks.clear();
+  auto processTypeInfo = [&](ShaderSource *source, bool isVertex) {
+    auto type = source->get_derived_info().m_type;
     for (auto &prop : type.get_properties()) {
       auto name = prop.get_name();
       auto type = prop.get_type().get_name();
@@ -18,23 +69,162 @@ void glLinkProgram(Program *program) {
       case ShaderSourceMeta::Attribute:
         program->attributes[name] = {attributeIndex++, type, name};
         break;
-      case ShaderSourceMeta::Uniform:
-        program->unifroms[name] = {uniformIndex++, type, name};
+      case ShaderSourceMeta::Uniform: {
+        // 两个 shader 中同名的 uniform 共用一个 location
+        auto search = program->unifroms.find(name);
+        if (search == program->unifroms.end()) {
+          program->unifroms[name] = {uniformIndex++, type, name};
+          // 记录元素类型与成员字节数, 数组 uniform 可一次写入多个元素
+          program->uniformSlots.push_back(
+              {prop.get_metadata(3).get_value<rttr::type>(),
+               prop.get_metadata(1).get_value<size_t>()});
+        }
+        auto &slot = program->uniformSlots[program->unifroms[name].location];
+        auto data = prop.get_value(*source).get_value<uint8_t *>();
+        (isVertex ? slot.vertexData : slot.fragmentData) = data;
         break;
+      }
       case ShaderSourceMeta::Varying:
         // program->varyings[name] = {varyingIndex++, type, name};
         break;
+      case ShaderSourceMeta::UniformBlock: {
+        // 两个 shader 中同名的 block 为同一个
+        auto &blocks = program->uniformBlocks;
+        auto block =
+            std::find_if(blocks.begin(), blocks.end(),
+                         [&](auto &info) { return info.name == name; });
+        auto value = prop.get_value(*source);
+        if (block == blocks.end()) {
+          blocks.push_back({name, prop.get_metadata(1).get_value<size_t>()});
+          block = blocks.end() - 1;
+          auto blockType = prop.get_metadata(3).get_value<rttr::type>();
+          if (size_t size = std140Layout(blockType, value, block->layout))
+            block->size = size;
+        }
+        auto data = value.get_value<uint8_t *>();
+        (isVertex ? block->vertexData : block->fragmentData) = data;
+        break;
+      }
       }
     }
   };
 
-  processTypeInfo(program->vertexShader->source->get_derived_info().m_type);
-  processTypeInfo(program->fragmentShader->source->get_derived_info().m_type);
+  processTypeInfo(program->vertexShader->source, true);
+  processTypeInfo(program->fragmentShader->source, false);
+}
+
+void glBufferData(int location, int length, const void *data, int usage) {
+  CPPGL_TRACE("gl", "glBufferData");
+  Buffer *target = Helper::getBuffer(location);
+  if (target == nullptr)
+    return;
+
+  // 重新指定数据会隐式 unmap
+  target->mapAccess = 0;
+  // data 为空即 orphan, 绘制都是同步完成的, 没有仍在读取旧内容的绘制,
+  // 所以容量足够时直接复用原存储, 每帧上传动态数据不会重新分配
+  void *store = target->reserve(length);
+  if (data != nullptr)
+    memcpy(store, data, length);
+}
+
+void glBufferSubData(int location, int offset, int length, const void *data) {
+  CPPGL_TRACE("gl", "glBufferSubData");
+  Buffer *target = Helper::getBuffer(location);
+  if (target == nullptr || target->store == nullptr || target->mapAccess)
+    return;
+  if (offset < 0 || length < 0 || offset + length > target->length)
+    return;
+
+  memcpy(static_cast<uint8_t *>(target->store) + offset, data, length);
+}
+
+void *glMapBufferRange(int location, int offset, int length, int access) {
+  CPPGL_TRACE("gl", "glMapBufferRange");
+  Buffer *target = Helper::getBuffer(location);
+  if (target == nullptr || target->store == nullptr || target->mapAccess)
+    return nullptr;
+  if (offset < 0 || length <= 0 || offset + length > target->length)
+    return nullptr;
+  if (!(access & (GL_MAP_READ_BIT | GL_MAP_WRITE_BIT)))
+    return nullptr;
+
+  // 直接返回存储内的地址, 不经过中间拷贝;
+  // INVALIDATE_RANGE/INVALIDATE_BUFFER 只表示旧内容可丢弃, 无需额外处理
+  target->mapOffset = offset;
+  target->mapLength = length;
+  target->mapAccess = access;
+  return static_cast<uint8_t *>(target->store) + offset;
+}
+
+bool glUnmapBuffer(int location) {
+  CPPGL_TRACE("gl", "glUnmapBuffer");
+  Buffer *target = Helper::getBuffer(location);
+  if (target == nullptr || !target->mapAccess)
+    return false;
+
+  target->mapOffset = 0;
+  target->mapLength = 0;
+  target->mapAccess = 0;
+  return true;
+}
+
+bool glBufferDataFromFile(int location, const char *path, size_t offset,
+                          int length, FileAdvice advice) {
+  CPPGL_TRACE("gl", "glBufferDataFromFile");
+  Buffer *target = Helper::getBuffer(location);
+  if (target == nullptr || length < 0)
+    return false;
+  auto file = MappedFile::open(path);
+  if (file == nullptr || offset + length > file->size)
+    return false;
+
+  file->advise(offset, length, advice);
+  target->release();
+  target->mapping = file;
+  target->data = file->data + offset;
+  target->length = length;
+  return true;
+}
+
+void glMultiDrawArrays(int mode, const int *first, const int *count,
+                       int drawCount) {
+  CPPGL_TRACE("gl", "glMultiDrawArrays");
+  std::vector<Helper::DrawCommand> commands(drawCount);
+  for (int i = 0; i < drawCount; i++)
+    commands[i] = {first[i], count[i], nullptr, 1, 0, 0};
+  Helper::draw(mode, 0, commands.data(), drawCount);
+}
+
+void glMultiDrawElements(int mode, const int *count, int dataType,
+                         const void *const *indices, int drawCount) {
+  CPPGL_TRACE("gl", "glMultiDrawElements");
+  std::vector<Helper::DrawCommand> commands(drawCount);
+  for (int i = 0; i < drawCount; i++)
+    commands[i] = {0, count[i], indices[i], 1, 0, 0};
+  Helper::draw(mode, dataType, commands.data(), drawCount);
+}
+
+void glMultiDrawElementsIndirect(int mode, int dataType, const void *indirect,
+                                 int drawCount, int stride) {
+  CPPGL_TRACE("gl", "glMultiDrawElementsIndirect");
+  if (stride == 0)
+    stride = sizeof(DrawElementsIndirectCommand);
+  std::vector<Helper::DrawCommand> commands(drawCount);
+  for (int i = 0; i < drawCount; i++) {
+    DrawElementsIndirectCommand command;
+    memcpy(&command, (const uint8_t *)indirect + i * stride, sizeof(command));
+    commands[i] = {(int)command.firstIndex, (int)command.count, nullptr,
+                   (int)command.instanceCount, command.baseVertex,
+                   (int)command.baseInstance};
+  }
+  Helper::draw(mode, dataType, commands.data(), drawCount);
 }
 
 void glTexImage2D(int location, int mipLevel, int internalFormat, int width,
                   int height, int border, int format, int dataType,
                   const void *data) {
+  CPPGL_TRACE("gl", "glTexImage2D");
   auto state = GLOBAL::GLOBAL_STATE;
   Texture *target = nullptr;
   if (location == GL_TEXTURE_2D) {
@@ -44,31 +234,79 @@ void glTexImage2D(int location, int mipLevel, int internalFormat, int width,
     target->mips.resize(mipLevel + 1);
 
   if (data == nullptr) {
-    int storeSize = width * height;
-    if (internalFormat == GL_RGBA)
-      storeSize *= 4;
-
-    if (dataType == GL_UNSIGNED_BYTE)
-      data = malloc(sizeof(uint8_t) * storeSize);
-    if (dataType == GL_UNSIGNED_SHORT)
-      data = malloc(sizeof(uint16_t) * storeSize);
+    size_t storeSize =
+        (size_t)width * height * Helper::texelSize(format, dataType);
+    if (storeSize != 0)
+      data = malloc(storeSize);
   }
 
   target->mips[mipLevel] = new TextureBuffer{
       data, 0, width, height, format, border, dataType, internalFormat};
 }
 
+bool glTexImage2DFromFile(int location, int mipLevel, int internalFormat,
+                          int width, int height, int border, int format,
+                          int dataType, const char *path, size_t offset,
+                          FileAdvice advice) {
+  CPPGL_TRACE("gl", "glTexImage2DFromFile");
+  Texture *target = Helper::getTextureFrom(location);
+  if (target == nullptr)
+    return false;
+
+  size_t length = (size_t)width * height * Helper::texelSize(format, dataType);
+  if (length == 0)
+    return false;
+
+  auto file = MappedFile::open(path);
+  if (file == nullptr || offset + length > file->size)
+    return false;
+
+  file->advise(offset, length, advice);
+  glTexImage2D(location, mipLevel, internalFormat, width, height, border,
+               format, dataType, file->data + offset);
+  target->mips[mipLevel]->length = length;
+  target->mips[mipLevel]->mapping = file;
+  return true;
+}
+
 void glClear(int mask) {
+  CPPGL_TRACE("gl", "glClear");
   auto vao = GLOBAL::GLOBAL_STATE->VERTEX_ARRAY_BINDING;
   auto fbo = GLOBAL::GLOBAL_STATE->FRAMEBUFFER_BINDING;
   const auto &viewport = GLOBAL::GLOBAL_STATE->VIEWPORT;
   const int width = (int)viewport.z;
   const int height = (int)viewport.w;
+  // 只清理 scissor 范围内的行
+  const box2 clipBox = Helper::getClipBox(width, height);
+  const int minX = (int)clipBox.min.x;
+  const int minY = (int)clipBox.min.y;
+  const int maxX = (int)clipBox.max.x;
+  const int maxY = (int)clipBox.max.y;
+  if (minX >= maxX || minY >= maxY || Helper::conditionalRenderDiscards())
+    return;
 
   if (fbo == nullptr)
     fbo = GLOBAL::DEFAULT_FRAMEBUFFER;
 
-  if (mask | GL_COLOR_BUFFER_BIT &&
+  // 按光栅化的 tile 行划分, 每段行由绘制时写它的同一个线程清理
+  const int tilesY = (height + Helper::TILE_SIZE - 1) / Helper::TILE_SIZE;
+  auto forEachRowBand = [&](const std::function<void(int, int)> &job) {
+    Helper::forEachTileRow(tilesY, [&](int tileY) {
+      int first = std::max(tileY * Helper::TILE_SIZE, minY);
+      int last = std::min((tileY + 1) * Helper::TILE_SIZE, maxY);
+      if (first < last)
+        job(first, last);
+    });
+  };
+
+  // 与绘制一样受 color/depth write mask 控制
+  const int colorMask = GLOBAL::GLOBAL_STATE->COLOR_WRITEMASK & 0xf;
+  if (colorMask == 0)
+    mask &= ~GL_COLOR_BUFFER_BIT;
+  if (!GLOBAL::GLOBAL_STATE->DEPTH_WRITEMASK)
+    mask &= ~GL_DEPTH_BUFFER_BIT;
+
+  if (mask & GL_COLOR_BUFFER_BIT &&
       fbo->COLOR_ATTACHMENT0.attachment != nullptr &&
       fbo->COLOR_ATTACHMENT0.attachment->mips.size() != 0) {
     auto frameBufferTextureBuffer =
@@ -76,180 +314,137 @@ void glClear(int mask) {
     auto color = GLOBAL::GLOBAL_STATE->COLOR_CLEAR_VALUE;
     auto colorRedU8 = (uint8_t)(color.r * 255);
     auto colorGreenU8 = (uint8_t)(color.g * 255);
-    auto colorBlueU8 = (uint8_t)(color.g * 255);
-    auto colorAlphaU8 = (uint8_t)(color.g * 255);
+    auto colorBlueU8 = (uint8_t)(color.b * 255);
+    auto colorAlphaU8 = (uint8_t)(color.a * 255);
+    // 多重采样时清理每个像素的所有sample
+    const int samples = frameBufferTextureBuffer->samples;
     // clearColor
-    for (int x = 0; x < width; x++) {
-      for (int y = 0; y < height; y++) {
-        int bufferIndex = x + y * width;
+    forEachRowBand([&](int first, int last) {
+      for (int y = first; y < last; y++) {
+        int rowIndex = y * width;
+        int begin = (rowIndex + minX) * samples;
+        int end = (rowIndex + maxX) * samples;
         if (frameBufferTextureBuffer->internalFormat == GL_RGBA) {
           if (frameBufferTextureBuffer->dataType == GL_FLOAT) {
             vec4 *frameBuffer = (vec4 *)frameBufferTextureBuffer->data;
-            frameBuffer[bufferIndex] = color;
+            if (colorMask == 0xf)
+              std::fill(frameBuffer + begin, frameBuffer + end, color);
+            else
+              for (int bufferIndex = begin; bufferIndex < end; bufferIndex++)
+                for (int c = 0; c < 4; c++)
+                  if (colorMask >> c & 1)
+                    (&frameBuffer[bufferIndex].r)[c] = (&color.r)[c];
           } else if (frameBufferTextureBuffer->dataType == GL_UNSIGNED_BYTE) {
             uint8_t *frameBuffer = (uint8_t *)frameBufferTextureBuffer->data;
-            frameBuffer[bufferIndex * 4] = colorRedU8;
-            frameBuffer[bufferIndex * 4 + 1] = colorGreenU8;
-            frameBuffer[bufferIndex * 4 + 2] = colorBlueU8;
-            frameBuffer[bufferIndex * 4 + 3] = colorAlphaU8;
+            const uint8_t colorU8[] = {colorRedU8, colorGreenU8, colorBlueU8,
+                                       colorAlphaU8};
+            for (int bufferIndex = begin; bufferIndex < end; bufferIndex++)
+              for (int c = 0; c < 4; c++)
+                if (colorMask >> c & 1)
+                  frameBuffer[bufferIndex * 4 + c] = colorU8[c];
           }
         }
       }
-    }
+    });
   }
-  if (mask | GL_DEPTH_BUFFER_BIT &&
+  if (mask & GL_DEPTH_BUFFER_BIT &&
       fbo->DEPTH_ATTACHMENT.attachment != nullptr &&
       fbo->DEPTH_ATTACHMENT.attachment->mips.size() != 0) {
-    auto zBuffer = static_cast<float *>(
-        const_cast<void *>(fbo->DEPTH_ATTACHMENT.attachment->mips[0]->data));
+    auto depthBuffer = fbo->DEPTH_ATTACHMENT.attachment->mips[0];
+    auto zBuffer = static_cast<float *>(const_cast<void *>(depthBuffer->data));
+    const int samples = depthBuffer->samples;
 
     // 重置zBuffer
-    std::fill_n(zBuffer, width * height, -std::numeric_limits<float>::max());
+    forEachRowBand([&](int first, int last) {
+      for (int y = first; y < last; y++)
+        std::fill(zBuffer + (y * width + minX) * samples,
+                  zBuffer + (y * width + maxX) * samples,
+                  -std::numeric_limits<float>::max());
+    });
+  }
+  if (mask & GL_STENCIL_BUFFER_BIT &&
+      fbo->STENCIL_ATTACHMENT.attachment != nullptr &&
+      fbo->STENCIL_ATTACHMENT.attachment->mips.size() != 0) {
+    auto stencilTextureBuffer = fbo->STENCIL_ATTACHMENT.attachment->mips[0];
+    auto stencilBuffer = static_cast<uint8_t *>(
+        const_cast<void *>(stencilTextureBuffer->data));
+    const int samples = stencilTextureBuffer->samples;
+    auto stencilMask = GLOBAL::GLOBAL_STATE->STENCIL_WRITE_MASK;
+    auto stencilValue = GLOBAL::GLOBAL_STATE->STENCIL_CLEAR_VALUE & stencilMask;
+
+    // 重置stencil buffer, 受STENCIL_WRITE_MASK控制
+    forEachRowBand([&](int first, int last) {
+      for (int y = first; y < last; y++) {
+        uint8_t *begin = stencilBuffer + (y * width + minX) * samples;
+        uint8_t *end = stencilBuffer + (y * width + maxX) * samples;
+        if ((stencilMask & 0xff) == 0xff)
+          std::fill(begin, end, (uint8_t)stencilValue);
+        else
+          for (uint8_t *value = begin; value < end; value++)
+            *value = (*value & ~stencilMask) | stencilValue;
+      }
+    });
   }
 }
 
+namespace {
+/**
+ * @brief glUniform* 的公共部分, 类型与声明(数组为元素类型)不一致时忽略,
+ * 写入 count 个元素, 超出成员大小的部分截断
+ */
+template <typename T>
+void uniform(int location, int count, const void *data) {
+  auto slot = Helper::getUniformSlot(location);
+  if (slot == nullptr || count <= 0 || slot->type != rttr::type::get<T>())
+    return;
+  size_t size = std::min(count * sizeof(T), slot->size);
+  if (slot->vertexData != nullptr)
+    memcpy(slot->vertexData, data, size);
+  if (slot->fragmentData != nullptr)
+    memcpy(slot->fragmentData, data, size);
+}
+} // namespace
+
 void glUniform1i(int location, int value) {
-  Helper::setUniform(
-      location, [&](rttr::property &vertexProp, rttr::property &fragmentProp,
-                    ShaderSource *vertexShader, ShaderSource *fragmentShader,
-                    rttr::type &, rttr::type &) {
-        if (vertexProp.is_valid()) {
-          auto ptr = vertexProp.get_value(*vertexShader).get_value<int *>();
-          *ptr = value;
-        }
-        if (fragmentProp.is_valid()) {
-          auto ptr = fragmentProp.get_value(*fragmentShader).get_value<int *>();
-          *ptr = value;
-        }
-      });
+  CPPGL_TRACE("gl", "glUniform1i");
+  uniform<int>(location, 1, &value);
 }
 
 void glUniform1f(int location, float value) {
-  Helper::setUniform(
-      location, [&](rttr::property &vertexProp, rttr::property &fragmentProp,
-                    ShaderSource *vertexShader, ShaderSource *fragmentShader,
-                    rttr::type &, rttr::type &) {
-        if (vertexProp.is_valid()) {
-          auto ptr = vertexProp.get_value(*vertexShader).get_value<float *>();
-          *ptr = value;
-        }
-        if (fragmentProp.is_valid()) {
-          auto ptr =
-              fragmentProp.get_value(*fragmentShader).get_value<float *>();
-          *ptr = value;
-        }
-      });
+  CPPGL_TRACE("gl", "glUniform1f");
+  uniform<float>(location, 1, &value);
 }
 
 void glUniform2fv(int location, int count, const void *data) {
-  Helper::setUniform(
-      location, [&](rttr::property &vertexProp, rttr::property &fragmentProp,
-                    ShaderSource *vertexShader, ShaderSource *fragmentShader,
-                    rttr::type &, rttr::type &) {
-        if (vertexProp.is_valid()) {
-          auto var = vertexProp.get_value(*vertexShader);
-          auto varPtr = var.get_value<vec2 *>();
-          auto size = vertexProp.get_metadata(1).get_value<size_t>();
-          memcpy(varPtr, data, size);
-        }
-
-        if (fragmentProp.is_valid()) {
-          auto var = fragmentProp.get_value(*fragmentShader);
-          auto varPtr = var.get_value<vec2 *>();
-          auto size = fragmentProp.get_metadata(1).get_value<size_t>();
-          memcpy(varPtr, data, size);
-        }
-      });
+  CPPGL_TRACE("gl", "glUniform2fv");
+  uniform<vec2>(location, count, data);
 }
 
 void glUniform3fv(int location, int count, const void *data) {
-  Helper::setUniform(
-      location, [&](rttr::property &vertexProp, rttr::property &fragmentProp,
-                    ShaderSource *vertexShader, ShaderSource *fragmentShader,
-                    rttr::type &, rttr::type &) {
-        if (vertexProp.is_valid()) {
-          auto var = vertexProp.get_value(*vertexShader);
-          auto varPtr = var.get_value<vec3 *>();
-          auto size = vertexProp.get_metadata(1).get_value<size_t>();
-          memcpy(varPtr, data, size);
-        }
-
-        if (fragmentProp.is_valid()) {
-          auto var = fragmentProp.get_value(*fragmentShader);
-          auto varPtr = var.get_value<vec3 *>();
-          auto size = fragmentProp.get_metadata(1).get_value<size_t>();
-          memcpy(varPtr, data, size);
-        }
-      });
+  CPPGL_TRACE("gl", "glUniform3fv");
+  uniform<vec3>(location, count, data);
 }
 
 void glUniform4fv(int location, int count, const void *data) {
-  Helper::setUniform(
-      location, [&](rttr::property &vertexProp, rttr::property &fragmentProp,
-                    ShaderSource *vertexShader, ShaderSource *fragmentShader,
-                    rttr::type &, rttr::type &) {
-        if (vertexProp.is_valid()) {
-          auto var = vertexProp.get_value(*vertexShader);
-          auto varPtr = var.get_value<vec4 *>();
-          auto size = vertexProp.get_metadata(1).get_value<size_t>();
-          memcpy(varPtr, data, size);
-        }
-
-        if (fragmentProp.is_valid()) {
-          auto var = fragmentProp.get_value(*fragmentShader);
-          auto varPtr = var.get_value<vec4 *>();
-          auto size = fragmentProp.get_metadata(1).get_value<size_t>();
-          memcpy(varPtr, data, size);
-        }
-      });
+  CPPGL_TRACE("gl", "glUniform4fv");
+  uniform<vec4>(location, count, data);
 }
 
 void glUniformMatrix3fv(int location, int count, bool transpose,
                         const void *data) {
-  Helper::setUniform(
-      location, [&](rttr::property &vertexProp, rttr::property &fragmentProp,
-                    ShaderSource *vertexShader, ShaderSource *fragmentShader,
-                    rttr::type &, rttr::type &) {
-        if (vertexProp.is_valid()) {
-          auto var = vertexProp.get_value(*vertexShader);
-          auto varPtr = var.get_value<mat3 *>();
-          auto size = vertexProp.get_metadata(1).get_value<size_t>();
-          memcpy(varPtr, data, size);
-        }
-
-        if (fragmentProp.is_valid()) {
-          auto var = fragmentProp.get_value(*fragmentShader);
-          auto varPtr = var.get_value<mat3 *>();
-          auto size = fragmentProp.get_metadata(1).get_value<size_t>();
-          memcpy(varPtr, data, size);
-        }
-      });
+  CPPGL_TRACE("gl", "glUniformMatrix3fv");
+  uniform<mat3>(location, count, data);
 }
 
 void glUniformMatrix4fv(int location, int count, bool transpose,
                         const void *data) {
-  Helper::setUniform(
-      location, [&](rttr::property &vertexProp, rttr::property &fragmentProp,
-                    ShaderSource *vertexShader, ShaderSource *fragmentShader,
-                    rttr::type &, rttr::type &) {
-        if (vertexProp.is_valid()) {
-          auto var = vertexProp.get_value(*vertexShader);
-          auto varPtr = var.get_value<mat4 *>();
-          auto size = vertexProp.get_metadata(1).get_value<size_t>();
-          memcpy(varPtr, data, size);
-        }
-
-        if (fragmentProp.is_valid()) {
-          auto var = fragmentProp.get_value(*fragmentShader);
-          auto varPtr = var.get_value<mat4 *>();
-          auto size = fragmentProp.get_metadata(1).get_value<size_t>();
-          memcpy(varPtr, data, size);
-        }
-      });
+  CPPGL_TRACE("gl", "glUniformMatrix4fv");
+  uniform<mat4>(location, count, data);
 }
 
 void glFramebufferTexture2D(int target, int attachment, int textarget,
                             Texture *texture, int level) {
+  CPPGL_TRACE("gl", "glFramebufferTexture2D");
   if (target == GL_FRAMEBUFFER && GLOBAL::GLOBAL_STATE->RENDERBUFFER_BINDING) {
     if (attachment == GL_COLOR_ATTACHMENT0) {
       if (textarget == GL_TEXTURE_2D) {
@@ -265,31 +460,286 @@ void glFramebufferTexture2D(int target, int attachment, int textarget,
 void glFramebufferRenderbuffer(int target, int attachment,
                                int renderbufferTarget,
                                RenderBuffer *renderbuffer) {
+  CPPGL_TRACE("gl", "glFramebufferRenderbuffer");
   if (target == GL_FRAMEBUFFER && GLOBAL::GLOBAL_STATE->RENDERBUFFER_BINDING) {
+    if (attachment == GL_COLOR_ATTACHMENT0) {
+      if (renderbufferTarget == GL_RENDERBUFFER) {
+        GLOBAL::GLOBAL_STATE->FRAMEBUFFER_BINDING->COLOR_ATTACHMENT0 = {
+            AttachmentType::COLOR_ATTACHMENT0, 0, 0, renderbuffer->attachment};
+      }
+    }
     if (attachment == GL_DEPTH_ATTACHMENT) {
       if (renderbufferTarget == GL_RENDERBUFFER) {
         GLOBAL::GLOBAL_STATE->FRAMEBUFFER_BINDING->DEPTH_ATTACHMENT.attachment =
             renderbuffer->attachment;
       }
     }
+    if (attachment == GL_STENCIL_ATTACHMENT) {
+      if (renderbufferTarget == GL_RENDERBUFFER) {
+        GLOBAL::GLOBAL_STATE->FRAMEBUFFER_BINDING->STENCIL_ATTACHMENT
+            .attachment = renderbuffer->attachment;
+      }
+    }
   }
 }
 
 void glRenderbufferStorage(int target, int internalFormat, int width,
                            int height) {
-  if (target == GL_RENDERBUFFER) {
-    GLOBAL::GLOBAL_STATE->RENDERBUFFER_BINDING->format = internalFormat;
-    GLOBAL::GLOBAL_STATE->RENDERBUFFER_BINDING->width = width;
-    GLOBAL::GLOBAL_STATE->RENDERBUFFER_BINDING->height = height;
-
-    if (internalFormat == GL_DEPTH_COMPONENT32F) {
-      int length = sizeof(float) * width * height;
-      auto texture = new Texture();
-      texture->mips.push_back(new TextureBuffer{
-          malloc(length), length, width, height, GL_DEPTH_COMPONENT32F, 0,
-          GL_FLOAT, GL_DEPTH_COMPONENT32F});
-      GLOBAL::GLOBAL_STATE->RENDERBUFFER_BINDING->attachment = texture;
+  CPPGL_TRACE("gl", "glRenderbufferStorage");
+  glRenderbufferStorageMultisample(target, 0, internalFormat, width, height);
+}
+
+void glRenderbufferStorageMultisample(int target, int samples,
+                                      int internalFormat, int width,
+                                      int height) {
+  CPPGL_TRACE("gl", "glRenderbufferStorageMultisample");
+  if (target != GL_RENDERBUFFER)
+    return;
+  auto renderbuffer = GLOBAL::GLOBAL_STATE->RENDERBUFFER_BINDING;
+  renderbuffer->format = internalFormat;
+  renderbuffer->width = width;
+  renderbuffer->height = height;
+  renderbuffer->samples = samples > 1 ? MAX_SAMPLES : 0;
+
+  int format = 0;
+  int dataType = 0;
+  int elementSize = 0;
+  if (internalFormat == GL_DEPTH_COMPONENT32F) {
+    format = GL_DEPTH_COMPONENT32F;
+    dataType = GL_FLOAT;
+    elementSize = sizeof(float);
+  } else if (internalFormat == GL_STENCIL_INDEX8) {
+    format = GL_STENCIL_INDEX8;
+    dataType = GL_UNSIGNED_BYTE;
+    elementSize = sizeof(uint8_t);
+  } else if (internalFormat == GL_RGBA8) {
+    format = GL_RGBA;
+    dataType = GL_UNSIGNED_BYTE;
+    elementSize = sizeof(uint8_t) * 4;
+  } else if (internalFormat == GL_RGBA32F) {
+    format = GL_RGBA;
+    dataType = GL_FLOAT;
+    elementSize = sizeof(vec4);
+  } else {
+    return;
+  }
+
+  int sampleCount = std::max(renderbuffer->samples, 1);
+  int length = elementSize * width * height * sampleCount;
+  auto texture = new Texture();
+  auto buffer = new TextureBuffer{malloc(length), length, width,  height,
+                                  format,         0,      dataType, format};
+  buffer->samples = sampleCount;
+  Helper::firstTouch(buffer);
+  texture->mips.push_back(buffer);
+  renderbuffer->attachment = texture;
+}
+
+namespace {
+/**
+ * @brief resolve 一行, 同一像素的 sample 连续存放, 逐分量累加的循环
+ * 没有分支, 可以被编译器向量化
+ */
+void resolveRow(const float *src, float *dst, int count, int samples) {
+  const float scale = 1.f / samples;
+  for (int i = 0; i < count; i++) {
+    const float *pixel = src + i * samples * 4;
+    float sum[4] = {0, 0, 0, 0};
+    for (int s = 0; s < samples; s++)
+      for (int c = 0; c < 4; c++)
+        sum[c] += pixel[s * 4 + c];
+    for (int c = 0; c < 4; c++)
+      dst[i * 4 + c] = sum[c] * scale;
+  }
+}
+
+void resolveRow(const uint8_t *src, uint8_t *dst, int count, int samples) {
+  for (int i = 0; i < count; i++) {
+    const uint8_t *pixel = src + i * samples * 4;
+    // 加上 samples / 2 后整除, 四舍五入
+    uint32_t sum[4] = {0, 0, 0, 0};
+    for (int s = 0; s < samples; s++)
+      for (int c = 0; c < 4; c++)
+        sum[c] += pixel[s * 4 + c];
+    for (int c = 0; c < 4; c++)
+      dst[i * 4 + c] = (uint8_t)((sum[c] + samples / 2) / samples);
+  }
+}
+
+/**
+ * @brief 拷贝一个附件, 源为多重采样且目标不是时 resolve:
+ * 颜色取平均, 深度和 stencil 取第一个 sample
+ */
+void blitAttachment(TextureBuffer *src, TextureBuffer *dst, int elementSize,
+                    bool average, box2 srcBox, box2 dstBox) {
+  int srcX = (int)srcBox.min.x;
+  int srcY = (int)srcBox.min.y;
+  int dstX = (int)dstBox.min.x;
+  int dstY = (int)dstBox.min.y;
+  int srcWidth = (int)srcBox.max.x - srcX;
+  int srcHeight = (int)srcBox.max.y - srcY;
+  int dstWidth = (int)dstBox.max.x - dstX;
+  int dstHeight = (int)dstBox.max.y - dstY;
+  if (srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0)
+    return;
+  if (srcX < 0 || srcY < 0 || srcX + srcWidth > src->width ||
+      srcY + srcHeight > src->height)
+    return;
+  if (dstX < 0 || dstY < 0 || dstX + dstWidth > dst->width ||
+      dstY + dstHeight > dst->height)
+    return;
+
+  auto srcData = static_cast<const uint8_t *>(src->data);
+  auto dstData = static_cast<uint8_t *>(const_cast<void *>(dst->data));
+  bool sameSize = srcWidth == dstWidth && srcHeight == dstHeight;
+
+  // samples 相同且不缩放, 逐行拷贝
+  if (src->samples == dst->samples && sameSize) {
+    int rowLength = dstWidth * dst->samples * elementSize;
+    for (int y = 0; y < dstHeight; y++)
+      memcpy(dstData + ((dstY + y) * dst->width + dstX) * dst->samples *
+                           elementSize,
+             srcData + ((srcY + y) * src->width + srcX) * src->samples *
+                           elementSize,
+             rowLength);
+    return;
+  }
+
+  // resolve, 源和目标区域大小必须一致
+  if (src->samples > 1 && dst->samples == 1) {
+    if (!sameSize)
+      return;
+    for (int y = 0; y < dstHeight; y++) {
+      auto srcRow = srcData + ((srcY + y) * src->width + srcX) *
+                                  src->samples * elementSize;
+      auto dstRow = dstData + ((dstY + y) * dst->width + dstX) * elementSize;
+      if (average && src->dataType == GL_FLOAT)
+        resolveRow((const float *)srcRow, (float *)dstRow, dstWidth,
+                   src->samples);
+      else if (average && src->dataType == GL_UNSIGNED_BYTE)
+        resolveRow(srcRow, dstRow, dstWidth, src->samples);
+      else
+        for (int x = 0; x < dstWidth; x++)
+          memcpy(dstRow + x * elementSize,
+                 srcRow + x * src->samples * elementSize, elementSize);
+    }
+    return;
+  }
+
+  // 单采样之间缩放, 最近邻
+  if (src->samples == 1 && dst->samples == 1) {
+    for (int y = 0; y < dstHeight; y++) {
+      int sy = srcY + (int)((y + 0.5f) * srcHeight / dstHeight);
+      for (int x = 0; x < dstWidth; x++) {
+        int sx = srcX + (int)((x + 0.5f) * srcWidth / dstWidth);
+        memcpy(dstData + ((dstY + y) * dst->width + dstX + x) * elementSize,
+               srcData + (sy * src->width + sx) * elementSize, elementSize);
+      }
+    }
+  }
+}
+
+TextureBuffer *attachmentBuffer(const AttachmentInfo &info) {
+  if (info.attachment == nullptr || info.level < 0 ||
+      info.attachment->mips.size() <= (size_t)info.level)
+    return nullptr;
+  return info.attachment->mips[info.level];
+}
+} // namespace
+
+void glBlitFramebuffer(int srcX0, int srcY0, int srcX1, int srcY1, int dstX0,
+                       int dstY0, int dstX1, int dstY1, int mask, int filter) {
+  CPPGL_TRACE("gl", "glBlitFramebuffer");
+  auto state = GLOBAL::GLOBAL_STATE;
+  auto readFbo = state->READ_FRAMEBUFFER_BINDING;
+  auto drawFbo = state->FRAMEBUFFER_BINDING;
+  if (readFbo == nullptr)
+    readFbo = GLOBAL::DEFAULT_FRAMEBUFFER;
+  if (drawFbo == nullptr)
+    drawFbo = GLOBAL::DEFAULT_FRAMEBUFFER;
+  if (readFbo == drawFbo)
+    return;
+  // 默认 framebuffer 与绘制时一样按 viewport 分配, 绘制前也能作为源或目标
+  if (readFbo == GLOBAL::DEFAULT_FRAMEBUFFER ||
+      drawFbo == GLOBAL::DEFAULT_FRAMEBUFFER)
+    Helper::initDefaultFramebuffer((int)state->VIEWPORT.z,
+                                   (int)state->VIEWPORT.w);
+
+  box2 srcBox{{(float)std::min(srcX0, srcX1), (float)std::min(srcY0, srcY1)},
+              {(float)std::max(srcX0, srcX1), (float)std::max(srcY0, srcY1)}};
+  box2 dstBox{{(float)std::min(dstX0, dstX1), (float)std::min(dstY0, dstY1)},
+              {(float)std::max(dstX0, dstX1), (float)std::max(dstY0, dstY1)}};
+
+  if (mask & GL_COLOR_BUFFER_BIT) {
+    auto src = attachmentBuffer(readFbo->COLOR_ATTACHMENT0);
+    auto dst = attachmentBuffer(drawFbo->COLOR_ATTACHMENT0);
+    // 只支持相同格式之间拷贝
+    if (src != nullptr && dst != nullptr && src->dataType == dst->dataType &&
+        src->internalFormat == GL_RGBA && dst->internalFormat == GL_RGBA) {
+      int elementSize = src->dataType == GL_FLOAT ? sizeof(vec4) : 4;
+      blitAttachment(src, dst, elementSize, true, srcBox, dstBox);
     }
   }
+  if (mask & GL_DEPTH_BUFFER_BIT) {
+    auto src = attachmentBuffer(readFbo->DEPTH_ATTACHMENT);
+    auto dst = attachmentBuffer(drawFbo->DEPTH_ATTACHMENT);
+    if (src != nullptr && dst != nullptr)
+      blitAttachment(src, dst, sizeof(float), false, srcBox, dstBox);
+  }
+  if (mask & GL_STENCIL_BUFFER_BIT) {
+    auto src = attachmentBuffer(readFbo->STENCIL_ATTACHMENT);
+    auto dst = attachmentBuffer(drawFbo->STENCIL_ATTACHMENT);
+    if (src != nullptr && dst != nullptr)
+      blitAttachment(src, dst, sizeof(uint8_t), false, srcBox, dstBox);
+  }
+}
+
+void glDeleteQuery(Query *query) {
+  CPPGL_TRACE("gl", "glDeleteQuery");
+  // 删除进行中的 query 时一并结束
+  if (query->active)
+    *Helper::getQuerySlot(query->target) = nullptr;
+  if (GLOBAL::GLOBAL_STATE->CONDITIONAL_RENDER_QUERY == query)
+    GLOBAL::GLOBAL_STATE->CONDITIONAL_RENDER_QUERY = nullptr;
+  delete query;
+}
+
+void glBeginQuery(int target, Query *query) {
+  CPPGL_TRACE("gl", "glBeginQuery");
+  auto slot = Helper::getQuerySlot(target);
+  if (slot == nullptr || *slot != nullptr || query->active)
+    return;
+  *slot = query;
+  query->target = target;
+  query->active = true;
+  query->available = false;
+  if (target == GL_TIME_ELAPSED)
+    query->beginTime = std::chrono::steady_clock::now();
+  else
+    query->beginStatistics = Helper::mergeStatistics();
+}
+
+void glEndQuery(int target) {
+  CPPGL_TRACE("gl", "glEndQuery");
+  auto slot = Helper::getQuerySlot(target);
+  if (slot == nullptr || *slot == nullptr)
+    return;
+  auto query = *slot;
+  *slot = nullptr;
+  query->active = false;
+  query->available = true;
+
+  if (target == GL_TIME_ELAPSED) {
+    query->result = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - query->beginTime)
+                        .count();
+    return;
+  }
+  // 绘制同步执行, 此时各线程的计数都已写完
+  query->statistics = Helper::mergeStatistics() - query->beginStatistics;
+  if (target == GL_SAMPLES_PASSED)
+    query->result = query->statistics.pixelsWritten;
+  if (target == GL_ANY_SAMPLES_PASSED)
+    query->result = query->statistics.pixelsWritten != 0;
 }
 } // namespace CppGL
\ No newline at end of file
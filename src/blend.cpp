@@ -0,0 +1,128 @@
+#include <CppGL/blend.h>
+#include <CppGL/global-state.h>
+#include <array>
+#include <utility>
+
+namespace CppGL {
+namespace {
+constexpr int BLEND_FUNC_NUM = GL_SRC_ALPHA_SATURATE - GL_ZERO + 1;
+constexpr int BLEND_EQUATION_NUM = GL_MAX - GL_FUNC_ADD + 1;
+
+template <BlendFunc F> inline vec4 blendFactor(vec4 s, vec4 d, vec4 c) {
+  if constexpr (F == BlendFunc::ZERO)
+    return {0, 0, 0, 0};
+  if constexpr (F == BlendFunc::ONE)
+    return {1, 1, 1, 1};
+  if constexpr (F == BlendFunc::SRC_COLOR)
+    return s;
+  if constexpr (F == BlendFunc::ONE_MINUS_SRC_COLOR)
+    return vec4{1, 1, 1, 1} - s;
+  if constexpr (F == BlendFunc::DST_COLOR)
+    return d;
+  if constexpr (F == BlendFunc::ONE_MINUS_DST_COLOR)
+    return vec4{1, 1, 1, 1} - d;
+  if constexpr (F == BlendFunc::SRC_ALPHA)
+    return {s.a, s.a, s.a, s.a};
+  if constexpr (F == BlendFunc::ONE_MINUS_SRC_ALPHA)
+    return {1 - s.a, 1 - s.a, 1 - s.a, 1 - s.a};
+  if constexpr (F == BlendFunc::DST_ALPHA)
+    return {d.a, d.a, d.a, d.a};
+  if constexpr (F == BlendFunc::ONE_MINUS_DST_ALPHA)
+    return {1 - d.a, 1 - d.a, 1 - d.a, 1 - d.a};
+  if constexpr (F == BlendFunc::CONSTANT_COLOR)
+    return c;
+  if constexpr (F == BlendFunc::ONE_MINUS_CONSTANT_COLOR)
+    return vec4{1, 1, 1, 1} - c;
+  if constexpr (F == BlendFunc::CONSTANT_ALPHA)
+    return {c.a, c.a, c.a, c.a};
+  if constexpr (F == BlendFunc::ONE_MINUS_CONSTANT_ALPHA)
+    return {1 - c.a, 1 - c.a, 1 - c.a, 1 - c.a};
+  if constexpr (F == BlendFunc::SRC_ALPHA_SATURATE) {
+    float f = std::min(s.a, 1 - d.a);
+    return {f, f, f, 1};
+  }
+}
+
+template <BlendFunc S, BlendFunc D, BlendEquation E>
+void blendKernel(const vec4 *src, vec4 *dst, int count, vec4 blendColor) {
+  for (int i = 0; i < count; i++) {
+    vec4 s = src[i];
+    vec4 d = dst[i];
+    // MIN/MAX 不使用混合因子
+    if constexpr (E == BlendEquation::MIN) {
+      dst[i] = {std::min(s.r, d.r), std::min(s.g, d.g), std::min(s.b, d.b),
+                std::min(s.a, d.a)};
+    } else if constexpr (E == BlendEquation::MAX) {
+      dst[i] = {std::max(s.r, d.r), std::max(s.g, d.g), std::max(s.b, d.b),
+                std::max(s.a, d.a)};
+    } else {
+      vec4 sf = s * blendFactor<S>(s, d, blendColor);
+      vec4 df = d * blendFactor<D>(s, d, blendColor);
+      if constexpr (E == BlendEquation::FUNC_ADD)
+        dst[i] = sf + df;
+      if constexpr (E == BlendEquation::FUNC_SUBTRACT)
+        dst[i] = sf - df;
+      if constexpr (E == BlendEquation::FUNC_REVERSE_SUBTRACT)
+        dst[i] = df - sf;
+    }
+  }
+}
+
+template <size_t I> constexpr BlendKernel kernelAt() {
+  constexpr int s = I / (BLEND_FUNC_NUM * BLEND_EQUATION_NUM);
+  constexpr int d = I / BLEND_EQUATION_NUM % BLEND_FUNC_NUM;
+  constexpr int e = I % BLEND_EQUATION_NUM;
+  return &blendKernel<(BlendFunc)(GL_ZERO + s), (BlendFunc)(GL_ZERO + d),
+                      (BlendEquation)(GL_FUNC_ADD + e)>;
+}
+
+template <size_t... I>
+constexpr std::array<BlendKernel, sizeof...(I)>
+makeKernelTable(std::index_sequence<I...>) {
+  return {kernelAt<I>()...};
+}
+
+constexpr auto KERNEL_TABLE = makeKernelTable(
+    std::make_index_sequence<BLEND_FUNC_NUM * BLEND_FUNC_NUM *
+                             BLEND_EQUATION_NUM>());
+} // namespace
+
+BlendKernel getBlendKernel(BlendFunc src, BlendFunc dst, BlendEquation eq) {
+  int s = (int)src - GL_ZERO;
+  int d = (int)dst - GL_ZERO;
+  int e = (int)eq - GL_FUNC_ADD;
+  return KERNEL_TABLE[(s * BLEND_FUNC_NUM + d) * BLEND_EQUATION_NUM + e];
+}
+
+BlendState BlendState::from(const GlobalState *state) {
+  BlendState blendState;
+  blendState.enabled = state->BLEND;
+  blendState.color = state->BLEND_COLOR;
+  blendState.rgb = getBlendKernel(state->BLEND_SRC_RGB, state->BLEND_DST_RGB,
+                                  state->BLEND_EQUATION_RGB);
+  blendState.alpha =
+      getBlendKernel(state->BLEND_SRC_ALPHA, state->BLEND_DST_ALPHA,
+                     state->BLEND_EQUATION_ALPHA);
+  blendState.separate = blendState.rgb != blendState.alpha;
+  return blendState;
+}
+
+void BlendState::apply(const vec4 *src, vec4 *dst, int count) const {
+  if (!separate) {
+    rgb(src, dst, count, color);
+    return;
+  }
+
+  // alpha 单独算一遍再拼回去
+  const int chunk = 64;
+  vec4 alphaDst[chunk];
+  for (int begin = 0; begin < count; begin += chunk) {
+    int n = std::min(chunk, count - begin);
+    std::copy_n(dst + begin, n, alphaDst);
+    rgb(src + begin, dst + begin, n, color);
+    alpha(src + begin, alphaDst, n, color);
+    for (int i = 0; i < n; i++)
+      dst[begin + i].a = alphaDst[i].a;
+  }
+}
+} // namespace CppGL
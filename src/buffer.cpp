@@ -0,0 +1,54 @@
+#include <CppGL/buffer.h>
+#include <CppGL/mapped-file.h>
+#include <algorithm>
+#include <cstdlib>
+
+namespace CppGL {
+namespace {
+// 与 cache line 对齐, 也满足 AVX-512 对齐加载
+constexpr int BUFFER_ALIGNMENT = 64;
+
+void *alignedAlloc(int length) {
+  // aligned_alloc 要求大小为对齐的整数倍
+  size_t size = std::max(length, 1);
+  size = (size + BUFFER_ALIGNMENT - 1) / BUFFER_ALIGNMENT * BUFFER_ALIGNMENT;
+#ifdef _WIN32
+  return _aligned_malloc(size, BUFFER_ALIGNMENT);
+#else
+  return std::aligned_alloc(BUFFER_ALIGNMENT, size);
+#endif
+}
+
+void alignedFree(void *ptr) {
+#ifdef _WIN32
+  _aligned_free(ptr);
+#else
+  std::free(ptr);
+#endif
+}
+} // namespace
+
+void *Buffer::reserve(int length) {
+  if (store == nullptr || capacity < length || mapping != nullptr) {
+    release();
+    store = alignedAlloc(length);
+    capacity = length;
+  }
+  data = store;
+  this->length = length;
+  return store;
+}
+
+void Buffer::release() {
+  if (store != nullptr || mapping != nullptr) {
+    data = nullptr;
+    length = 0;
+  }
+  if (store != nullptr)
+    alignedFree(store);
+  store = nullptr;
+  capacity = 0;
+  mapAccess = 0;
+  mapping.reset();
+}
+} // namespace CppGL
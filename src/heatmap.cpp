@@ -0,0 +1,62 @@
+#include <CppGL/heatmap.h>
+#include <algorithm>
+#include <cmath>
+
+namespace CppGL {
+namespace {
+// 色带的控制点, 计数为0时为黑色
+const uint8_t RAMP[][3] = {
+    {0, 0, 0}, {0, 0, 255}, {0, 255, 0}, {255, 255, 0}, {255, 0, 0}};
+const int RAMP_SEGMENTS = sizeof(RAMP) / sizeof(RAMP[0]) - 1;
+} // namespace
+
+void Heatmap::resize(int width, int height) {
+  if (this->width == width && this->height == height)
+    return;
+  this->width = width;
+  this->height = height;
+  depthTests.assign(width * height, 0);
+  shaderInvocations.assign(width * height, 0);
+  shaderCycles.assign(width * height, 0);
+}
+
+void Heatmap::clear() {
+  std::fill(depthTests.begin(), depthTests.end(), 0);
+  std::fill(shaderInvocations.begin(), shaderInvocations.end(), 0);
+  std::fill(shaderCycles.begin(), shaderCycles.end(), 0);
+}
+
+uint64_t Heatmap::value(Channel channel, int index) const {
+  switch (channel) {
+  case DEPTH_TESTS:
+    return depthTests[index];
+  case FRAGMENT_SHADER_INVOCATIONS:
+    return shaderInvocations[index];
+  case FRAGMENT_SHADER_CYCLES:
+    return shaderCycles[index];
+  }
+  return 0;
+}
+
+uint64_t Heatmap::max(Channel channel) const {
+  uint64_t out = 0;
+  for (int i = 0, il = width * height; i < il; i++)
+    out = std::max(out, value(channel, i));
+  return out;
+}
+
+void Heatmap::toImage(Channel channel, uint8_t *rgba, uint64_t maxValue) const {
+  if (maxValue == 0)
+    maxValue = std::max(max(channel), (uint64_t)1);
+  for (int i = 0, il = width * height; i < il; i++) {
+    float t = std::min((float)value(channel, i) / maxValue, 1.f);
+    float position = t * RAMP_SEGMENTS;
+    int segment = std::min((int)position, RAMP_SEGMENTS - 1);
+    float f = position - segment;
+    for (int c = 0; c < 3; c++)
+      rgba[i * 4 + c] = (uint8_t)std::lround(
+          RAMP[segment][c] + (RAMP[segment + 1][c] - RAMP[segment][c]) * f);
+    rgba[i * 4 + 3] = 255;
+  }
+}
+} // namespace CppGL
@@ -1,6 +1,133 @@
 #include <CppGL/api.h>
+#include <unordered_map>
 
 namespace CppGL::Helper {
+/**
+ * @brief 同一行内通过测试的fragment, 攒成一批再统一 shade/blend/写入
+ */
+struct FragmentPacket {
+  static const int SIZE = 64;
+  int count = 0;
+  // 点精灵需要逐fragment设置 gl_PointCoord
+  bool point = false;
+  // 像素下标, 多重采样时 sample 下标为 bufferIndex * samples + s
+  int bufferIndex[SIZE];
+  // 覆盖且通过测试的sample, 按位; 每个sample单独插值深度
+  uint8_t coverage[SIZE];
+  float depth[SIZE][MAX_SAMPLES];
+  vec3 bcClip[SIZE];
+  vec2 pointCoord[SIZE];
+  vec4 color[SIZE];
+};
+
+/**
+ * @brief sample 在像素内的位置, 4x 使用旋转网格, 单采样即像素中心
+ */
+static const vec2 CENTER_SAMPLE_POSITIONS[] = {{0.5f, 0.5f}};
+static const vec2 MSAA4_SAMPLE_POSITIONS[] = {
+    {0.375f, 0.125f}, {0.875f, 0.375f}, {0.125f, 0.625f}, {0.625f, 0.875f}};
+
+// 每个任务处理的顶点数和图元 setup 数
+static const int VERTEX_GRAIN = 256;
+static const int SETUP_GRAIN = 256;
+
+/**
+ * @brief 三角形 setup 的结果, 由覆盖到的各个 tile 共用
+ */
+struct TriangleSetup {
+  float *varyingA;
+  float *varyingB;
+  float *varyingC;
+  triangle projDiv;
+  vec3 clipVecW;
+  vec3 clipVecZDivZ;
+  // 光栅化的像素范围, max 不包含
+  int minX;
+  int minY;
+  int maxX;
+  int maxY;
+  bool frontFacing;
+};
+
+/**
+ * @brief 点 setup 的结果, 以顶点为中心边长 size 的正方形
+ */
+struct PointSetup {
+  float *varying;
+  float left;
+  float bottom;
+  float size;
+  float depth;
+  int minX;
+  int minY;
+  int maxX;
+  int maxY;
+};
+
+/**
+ * @brief 线段 setup 的结果, 沿主轴在 [begin, end) 内逐像素步进
+ */
+struct LineSetup {
+  float *varyingA;
+  float *varyingB;
+  vec2 a;
+  float dx;
+  float dy;
+  float wA;
+  float wB;
+  float depthA;
+  float depthB;
+  bool xMajor;
+  float majorA;
+  float delta;
+  int begin;
+  int end;
+  int minX;
+  int minY;
+  int maxX;
+  int maxY;
+};
+
+static void readColors(TextureBuffer *target, const int *bufferIndex,
+                       vec4 *colors, int count) {
+  if (target->internalFormat != GL_RGBA)
+    return;
+  if (target->dataType == GL_FLOAT) {
+    vec4 *frameBuffer = (vec4 *)target->data;
+    for (int i = 0; i < count; i++)
+      colors[i] = frameBuffer[bufferIndex[i]];
+  } else if (target->dataType == GL_UNSIGNED_BYTE) {
+    uint8_t *frameBuffer = (uint8_t *)target->data;
+    for (int i = 0; i < count; i++) {
+      uint8_t *pixel = frameBuffer + bufferIndex[i] * 4;
+      colors[i] = vec4{(float)pixel[0], (float)pixel[1], (float)pixel[2],
+                       (float)pixel[3]} /
+                  255;
+    }
+  }
+}
+
+static void writeColors(TextureBuffer *target, const int *bufferIndex,
+                        const vec4 *colors, int count) {
+  if (target->internalFormat != GL_RGBA)
+    return;
+  if (target->dataType == GL_FLOAT) {
+    vec4 *frameBuffer = (vec4 *)target->data;
+    for (int i = 0; i < count; i++)
+      frameBuffer[bufferIndex[i]] = clamp(colors[i], 0, 1);
+  } else if (target->dataType == GL_UNSIGNED_BYTE) {
+    uint8_t *frameBuffer = (uint8_t *)target->data;
+    for (int i = 0; i < count; i++) {
+      auto color = clamp(colors[i], 0, 1);
+      uint8_t *pixel = frameBuffer + bufferIndex[i] * 4;
+      pixel[0] = (uint8_t)(color.r * 255);
+      pixel[1] = (uint8_t)(color.g * 255);
+      pixel[2] = (uint8_t)(color.b * 255);
+      pixel[3] = (uint8_t)(color.a * 255);
+    }
+  }
+}
+
 Texture *getTextureFrom(int location) {
   auto state = GLOBAL::GLOBAL_STATE;
   Texture *target = nullptr;
@@ -10,34 +137,370 @@ Texture *getTextureFrom(int location) {
   return target;
 }
 
-void setUniform(
-    int location,
-    std::function<void(rttr::property &, rttr::property &, ShaderSource *,
-                       ShaderSource *, rttr::type &, rttr::type &)>
-        fn) {
-  auto state = GLOBAL::GLOBAL_STATE;
-  Program *program = state->CURRENT_PROGRAM;
+int texelSize(int format, int dataType) {
+  int components = 0;
+  if (format == GL_LUMINANCE || format == GL_DEPTH_COMPONENT32F ||
+      format == GL_STENCIL_INDEX8)
+    components = 1;
+  else if (format == GL_RGB)
+    components = 3;
+  else if (format == GL_RGBA)
+    components = 4;
+
+  int componentSize = 0;
+  if (dataType == GL_UNSIGNED_BYTE)
+    componentSize = sizeof(uint8_t);
+  else if (dataType == GL_UNSIGNED_SHORT || dataType == GL_HALF_FLOAT)
+    componentSize = sizeof(uint16_t);
+  else if (dataType == GL_FLOAT)
+    componentSize = sizeof(float);
+  return components * componentSize;
+}
 
-  if (program == nullptr)
+/**
+ * @brief attribute 与 vertex shader 变量的绑定, 一次绘制内解析一次
+ */
+struct AttributeBinding {
+  AttributeFetcher fetch;
+  const uint8_t *base;
+  size_t stride;
+  int divisor;
+  float *varPtr;
+
+  // 32位索引加上 baseVertex 后可能超出 int, 偏移按64位计算
+  inline void fetchAt(int64_t index) const {
+    fetch(base + (int64_t)stride * index, varPtr);
+  }
+};
+
+/**
+ * @brief 一个 shader 副本, 用 ShaderCopyOps 在 mem 中构造,
+ * 类型不变时拷贝赋值, 地址保持不变
+ */
+struct ShaderCopy {
+  const ShaderCopyOps *ops = nullptr;
+  ShaderSource *shader = nullptr;
+  std::vector<std::max_align_t> mem;
+
+  ShaderCopy() = default;
+  // WorkerContext 在 vector 中移动时副本的地址不变
+  ShaderCopy(ShaderCopy &&other) noexcept
+      : ops(other.ops), shader(other.shader), mem(std::move(other.mem)) {
+    other.ops = nullptr;
+    other.shader = nullptr;
+  }
+  ShaderCopy &operator=(ShaderCopy &&other) = delete;
+  ~ShaderCopy() { reset(); }
+
+  void reset() {
+    if (shader != nullptr)
+      ops->destroy(shader);
+    shader = nullptr;
+    ops = nullptr;
+  }
+  ShaderSource *copy(const ShaderSource &src, const ShaderCopyOps *srcOps) {
+    if (shader != nullptr && ops == srcOps) {
+      ops->assign(shader, src);
+      return shader;
+    }
+    reset();
+    mem.resize((srcOps->size + sizeof(std::max_align_t) - 1) /
+               sizeof(std::max_align_t));
+    ops = srcOps;
+    shader = ops->construct(mem.data(), src);
+    return shader;
+  }
+};
+
+/**
+ * @brief 并行执行时线程独占的 shader 和临时内存
+ * shader 的输入输出都是成员变量, 不能在线程间共享, 每个线程使用拷贝构造的
+ * 副本; 绘制期间程序的 shader 只被读取, 各线程可以随时从它拷贝
+ */
+struct WorkerContext {
+  // 已为哪一次绘制初始化, 与 DrawStorage::drawId 不同时重新拷贝 shader
+  uint64_t drawId = 0;
+  ShaderSource *vertexShader = nullptr;
+  ShaderSource *fragmentShader = nullptr;
+  // varPtr 指向本线程的 vertex shader
+  std::vector<AttributeBinding> vertexAttributes;
+  std::vector<float> varyingLerped;
+  // 副本已同步到的 instance, 落后时重新拷贝 vertex shader
+  int vertexPass = 0;
+  ShaderCopy vertexCopy;
+  ShaderCopy fragmentCopy;
+};
+
+/**
+ * @brief draw 的临时存储, 每个调用线程一份, 在绘制之间保留,
+ * 只清空不释放, 大量小绘制时不用每次重新分配
+ */
+struct DrawStorage {
+  uint64_t drawId = 0;
+  std::vector<WorkerContext> workers;
+  std::vector<std::vector<int>> tileBins;
+  std::vector<TriangleSetup> triangleSetups;
+  std::vector<PointSetup> pointSetups;
+  std::vector<LineSetup> lineSetups;
+  std::vector<int64_t> shadedVertices;
+  std::vector<int> elementSlots;
+  std::vector<vec4> clipSpaceVertices;
+  std::vector<float> pointSizes;
+  std::vector<uint8_t> varyingMem;
+};
+
+static DrawStorage &drawStorage() {
+  thread_local DrawStorage storage;
+  return storage;
+}
+
+/**
+ * @brief 实际类型自己声明的 CPPGL_RTTR_PROP 成员上登记的 ShaderCopyOps,
+ * 基类成员上的只能拷贝基类部分, 不使用
+ */
+static const ShaderCopyOps *shaderCopyOps(const rttr::type &type) {
+  for (auto &prop : type.get_properties()) {
+    if (prop.get_declaring_type() != type)
+      continue;
+    auto ops = prop.get_metadata(2);
+    if (ops.is_type<const ShaderCopyOps *>())
+      return ops.get_value<const ShaderCopyOps *>();
+  }
+  return nullptr;
+}
+
+/**
+ * @brief 每个图元的顶点数
+ */
+static int primitiveSize(int mode) {
+  if (mode == GL_POINTS)
+    return 1;
+  if (mode == GL_LINES || mode == GL_LINE_STRIP || mode == GL_LINE_LOOP)
+    return 2;
+  return 3;
+}
+
+/**
+ * @brief 图元装配, 结果每 primitiveSize(mode) 个slot组成一个图元
+ * slot 为 -1 表示 primitive restart, 之后重新开始一段 strip/fan/loop
+ */
+static std::vector<int> assemblePrimitives(int mode,
+                                           const std::vector<int> &slots) {
+  std::vector<int> primitives;
+  primitives.reserve(mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN
+                         ? slots.size() * 3
+                         : slots.size() * 2);
+  int begin = 0;
+  // line loop 在每段结束时首尾相连
+  auto closeLoop = [&](int end) {
+    if (mode == GL_LINE_LOOP && end - begin >= 2)
+      primitives.insert(primitives.end(), {slots[end - 1], slots[begin]});
+  };
+  for (int ii = 0; ii < slots.size(); ii++) {
+    if (slots[ii] < 0) {
+      closeLoop(ii);
+      begin = ii + 1;
+      continue;
+    }
+    int n = ii - begin;
+    if (mode == GL_POINTS)
+      primitives.push_back(slots[ii]);
+    if (n < 1)
+      continue;
+    if (mode == GL_LINES && n % 2 == 1)
+      primitives.insert(primitives.end(), {slots[ii - 1], slots[ii]});
+    if (mode == GL_LINE_STRIP || mode == GL_LINE_LOOP)
+      primitives.insert(primitives.end(), {slots[ii - 1], slots[ii]});
+    if (n < 2)
+      continue;
+    if (mode == GL_TRIANGLES && n % 3 == 2)
+      primitives.insert(primitives.end(),
+                        {slots[ii - 2], slots[ii - 1], slots[ii]});
+    if (mode == GL_TRIANGLE_STRIP) {
+      // 奇数个三角形交换前两个顶点, 保持环绕方向一致
+      if (n % 2 == 0)
+        primitives.insert(primitives.end(),
+                          {slots[ii - 2], slots[ii - 1], slots[ii]});
+      else
+        primitives.insert(primitives.end(),
+                          {slots[ii - 1], slots[ii - 2], slots[ii]});
+    }
+    if (mode == GL_TRIANGLE_FAN)
+      primitives.insert(primitives.end(),
+                        {slots[begin], slots[ii - 1], slots[ii]});
+  }
+  closeLoop(slots.size());
+  return primitives;
+}
+
+void forEachTileRow(int tilesY, const std::function<void(int tileY)> &job) {
+  if (Jobs::numaAffinity()) {
+    Jobs::parallelForOwned(tilesY, job);
     return;
+  }
+  Jobs::parallelFor(tilesY, 1, [&](int begin, int end) {
+    for (int tileY = begin; tileY < end; tileY++)
+      job(tileY);
+  });
+}
 
-  auto vertexShader = program->vertexShader->source;
-  auto fragmentShader = program->fragmentShader->source;
-  auto vertexTypeInfo = vertexShader->get_derived_info().m_type;
-  auto fragmentTypeInfo = fragmentShader->get_derived_info().m_type;
+void firstTouch(TextureBuffer *buffer) {
+  if (!Jobs::numaAffinity() || buffer->data == nullptr || buffer->height <= 0)
+    return;
+  const size_t rowBytes = buffer->length / buffer->height;
+  const int tilesY = (buffer->height + TILE_SIZE - 1) / TILE_SIZE;
+  forEachTileRow(tilesY, [&](int tileY) {
+    int begin = tileY * TILE_SIZE;
+    int end = std::min(begin + TILE_SIZE, buffer->height);
+    memset((uint8_t *)buffer->data + begin * rowBytes, 0,
+           (end - begin) * rowBytes);
+  });
+}
 
-  for (auto [name, info] : program->unifroms) {
-    if (info.location == location) {
-      auto vertexProp = vertexTypeInfo.get_property(name);
-      auto fragmentProp = fragmentTypeInfo.get_property(name);
-      fn(vertexProp, fragmentProp, vertexShader, fragmentShader, vertexTypeInfo,
-         fragmentTypeInfo);
-      return;
+void initDefaultFramebuffer(int width, int height) {
+  auto fbo = GLOBAL::DEFAULT_FRAMEBUFFER;
+  if (fbo->COLOR_ATTACHMENT0.attachment != nullptr)
+    return;
+  auto state = GLOBAL::GLOBAL_STATE;
+  const size_t pixels = (size_t)width * height;
+  auto allocate = [&](size_t texelSize, int format, int dataType) {
+    int length = texelSize * pixels;
+    auto texture = new Texture();
+    texture->mips.push_back(new TextureBuffer{malloc(length), length, width,
+                                              height, format, 0, dataType,
+                                              format});
+    return texture;
+  };
+  auto color = allocate(sizeof(vec4), GL_RGBA, GL_FLOAT);
+  auto depth = allocate(sizeof(float), GL_DEPTH_COMPONENT32F, GL_FLOAT);
+  auto stencil =
+      allocate(sizeof(uint8_t), GL_STENCIL_INDEX8, GL_UNSIGNED_BYTE);
+  fbo->COLOR_ATTACHMENT0 = {AttachmentType::COLOR_ATTACHMENT0, 0, 0, color};
+  fbo->DEPTH_ATTACHMENT = {AttachmentType::DEPTH_ATTACHMENT, 0, 0, depth};
+  fbo->STENCIL_ATTACHMENT = {AttachmentType::STENCIL_ATTACHMENT, 0, 0,
+                             stencil};
+
+  // 按 tile 行填充, 同时完成 firstTouch
+  auto colorData = (vec4 *)color->mips[0]->data;
+  auto depthData = (float *)depth->mips[0]->data;
+  auto stencilData = (uint8_t *)stencil->mips[0]->data;
+  const int tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+  forEachTileRow(tilesY, [&](int tileY) {
+    size_t begin = (size_t)tileY * TILE_SIZE * width;
+    size_t end = (size_t)std::min((tileY + 1) * TILE_SIZE, height) * width;
+    std::fill(colorData + begin, colorData + end, state->COLOR_CLEAR_VALUE);
+    std::fill(depthData + begin, depthData + end,
+              -std::numeric_limits<float>::max());
+    memset(stencilData + begin, state->STENCIL_CLEAR_VALUE, end - begin);
+  });
+}
+
+box2 getClipBox(int width, int height) {
+  auto state = GLOBAL::GLOBAL_STATE;
+  box2 clipBox{{0, 0}, {(float)width, (float)height}};
+  // scissor 直接收窄遍历范围, 不做逐像素测试
+  if (state->SCISSOR_TEST) {
+    const auto &scissor = state->SCISSOR_BOX;
+    clipBox.clamp({{scissor.x, scissor.y},
+                   {scissor.x + scissor.z, scissor.y + scissor.w}});
+  }
+  return clipBox;
+}
+
+/**
+ * @brief 索引类型的字节数, 0 表示不是索引类型
+ */
+static int indexSize(int dataType) {
+  if (dataType == GL_UNSIGNED_BYTE)
+    return sizeof(uint8_t);
+  if (dataType == GL_UNSIGNED_SHORT)
+    return sizeof(uint16_t);
+  if (dataType == GL_UNSIGNED_INT)
+    return sizeof(uint32_t);
+  return 0;
+}
+
+template <typename T>
+static void collectIndexedVertices(const T *indices, const DrawCommand &command,
+                                   int64_t restartIndex,
+                                   std::vector<int64_t> &shadedVertices,
+                                   std::vector<int> &elementSlots) {
+  const int count = command.count;
+  int64_t minIndex = std::numeric_limits<int64_t>::max();
+  int64_t maxIndex = -1;
+  for (int ii = 0; ii < count; ii++) {
+    int64_t i = indices[ii];
+    if (i == restartIndex)
+      continue;
+    minIndex = std::min(minIndex, i);
+    maxIndex = std::max(maxIndex, i);
+  }
+
+  auto assignSlots = [&](auto &&slotOf) {
+    for (int ii = 0; ii < count; ii++) {
+      int64_t i = indices[ii];
+      if (i == restartIndex) {
+        elementSlots[ii] = -1;
+        continue;
+      }
+      int &slot = slotOf(i);
+      if (slot < 0) {
+        slot = shadedVertices.size();
+        // baseVertex 只影响读取attribute, restart 判断用原始索引值
+        shadedVertices.push_back(i + command.baseVertex);
+      }
+      elementSlots[ii] = slot;
+    }
+  };
+  // 索引范围不大时直接查表, 32位索引分布稀疏时退回哈希表
+  const int64_t range = maxIndex - minIndex + 1;
+  if (maxIndex < 0 || range <= (int64_t)count * 4 + 1024) {
+    std::vector<int> slotOf(std::max<int64_t>(range, 0), -1);
+    assignSlots([&](int64_t i) -> int & { return slotOf[i - minIndex]; });
+  } else {
+    std::unordered_map<int64_t, int> slotOf;
+    slotOf.reserve(count);
+    assignSlots([&](int64_t i) -> int & {
+      return slotOf.try_emplace(i, -1).first->second;
+    });
+  }
+}
+
+/**
+ * @brief 确定需要执行vertex shader的顶点
+ * 有索引时同一个顶点只shade一次, elementSlots 记录第ii个元素对应的slot,
+ * 图元直接由已shade的slot装配
+ */
+static void collectVertices(const DrawCommand &command, int dataType,
+                            const void *indicesPtr, int64_t restartIndex,
+                            std::vector<int64_t> &shadedVertices,
+                            std::vector<int> &elementSlots) {
+  const int count = command.count;
+  shadedVertices.clear();
+  elementSlots.resize(count);
+  if (dataType == GL_UNSIGNED_BYTE)
+    collectIndexedVertices((const uint8_t *)indicesPtr + command.first,
+                           command, restartIndex, shadedVertices,
+                           elementSlots);
+  else if (dataType == GL_UNSIGNED_SHORT)
+    collectIndexedVertices((const uint16_t *)indicesPtr + command.first,
+                           command, restartIndex, shadedVertices,
+                           elementSlots);
+  else if (dataType == GL_UNSIGNED_INT)
+    collectIndexedVertices((const uint32_t *)indicesPtr + command.first,
+                           command, restartIndex, shadedVertices,
+                           elementSlots);
+  else {
+    shadedVertices.resize(count);
+    for (int ii = 0; ii < count; ii++) {
+      shadedVertices[ii] = (int64_t)command.first + ii;
+      elementSlots[ii] = ii;
     }
   }
 }
 
-void draw(int mode, int first, int count, int dataType, const void *indices) {
+void draw(int mode, int dataType, const DrawCommand *commands,
+          int commandCount) {
   auto state = GLOBAL::GLOBAL_STATE;
   auto program = state->CURRENT_PROGRAM;
   auto vao = state->VERTEX_ARRAY_BINDING;
@@ -49,31 +512,67 @@ void draw(int mode, int first, int count, int dataType, const void *indices) {
   const auto &viewport = state->VIEWPORT;
   const int width = (int)viewport.z;
   const int height = (int)viewport.w;
-  std::vector<vec4> clipSpaceVertices(count);
 
   if (vao == nullptr)
     vao = GLOBAL::DEFAULT_VERTEX_ARRAY;
   if (fbo == nullptr)
     fbo = GLOBAL::DEFAULT_FRAMEBUFFER;
+  // 遮挡查询判定不可见, 顶点和 fragment 的开销都省掉
+  if (conditionalRenderDiscards())
+    return;
+  CPPGL_TRACE_BEGIN(setup, "pipeline", "setup");
 
-  const void *indicesPtr = nullptr;
-  if (indices != nullptr)
-    indicesPtr = indices;
-  else if (vao->indexBuffer != nullptr)
-    indicesPtr = vao->indexBuffer->data;
+  // uniform block 每次绘制从绑定的 buffer 拷贝一次
+  for (auto &block : program->uniformBlocks) {
+    if (block.binding < 0 ||
+        (size_t)block.binding >= state->uniformBufferBindings.size())
+      continue;
+    auto &range = state->uniformBufferBindings[block.binding];
+    if (range.buffer == nullptr || range.buffer->data == nullptr)
+      continue;
+    int available = range.buffer->length - range.offset;
+    int size = range.size ? std::min(range.size, available) : available;
+    size = std::min(size, (int)block.size);
+    if (size <= 0)
+      continue;
+    auto src = (const uint8_t *)range.buffer->data + range.offset;
+    // 逐成员从 std140 偏移拷贝, 超出绑定范围的部分不拷贝
+    auto copyBlock = [&](uint8_t *data) {
+      if (block.layout.empty()) {
+        memcpy(data, src, size);
+        return;
+      }
+      for (auto &copy : block.layout)
+        for (size_t i = 0; i < copy.count; i++) {
+          size_t offset = copy.bufferOffset + i * copy.bufferStride;
+          if (offset + copy.size > (size_t)size)
+            break;
+          memcpy(data + copy.dataOffset + i * copy.dataStride, src + offset,
+                 copy.size);
+        }
+    };
+    if (block.vertexData != nullptr)
+      copyBlock(block.vertexData);
+    if (block.fragmentData != nullptr)
+      copyBlock(block.fragmentData);
+  }
 
-  const uint8_t *indicesU8Ptr = (uint8_t *)indicesPtr;
-  const uint16_t *indicesU16Ptr = (uint16_t *)indicesPtr;
+  const int vertexPerPrimitive = primitiveSize(mode);
+  // restart 索引为索引类型的最大值
+  int64_t restartIndex = -1;
+  if (indexSize(dataType) && state->PRIMITIVE_RESTART_FIXED_INDEX)
+    restartIndex = (int64_t(1) << (indexSize(dataType) * 8)) - 1;
 
   /**
-   * @brief 分配varying内存 count * (varying size 总和)
+   * @brief varying内存布局, 每个子绘制按 shadedCount * (varying size 总和) 分配
    * |               内存布局                |
    * | count0             count1            |
    * | varyingA varyingB  varyingA varyingB |
    */
   int varyingNum = 0;
-  int varyingSizeSumU8 = 0;
-  std::map<str, int> varyingOffsetMap;
+  // size_t: slot * varyingSizeSumU8 等偏移超过 2GB 时不溢出
+  size_t varyingSizeSumU8 = 0;
+  std::map<str, size_t> varyingOffsetMap;
   for (auto &prop : vertexTypeInfo.get_properties())
     if (prop.get_metadata(0).get_value<ShaderSourceMeta>() ==
         ShaderSourceMeta::Varying) {
@@ -82,245 +581,822 @@ void draw(int mode, int first, int count, int dataType, const void *indices) {
       varyingSizeSumU8 += size;
       varyingNum++;
     }
-  uint8_t *const varyingMemU8 = (uint8_t *)malloc(varyingSizeSumU8 * count);
-  uint8_t *const varyingLerpedMemU8 = (uint8_t *)malloc(varyingSizeSumU8);
 
   /**
    * @brief 初始化frameBuffer zBuffer
    */
-  if (nullptr == fbo->COLOR_ATTACHMENT0.attachment &&
-      fbo == GLOBAL::DEFAULT_FRAMEBUFFER) {
-    // 初始化framebuffer
-    {
-      int length = sizeof(vec4) * width * height;
-      auto texture = new Texture();
-      texture->mips.push_back(new TextureBuffer{malloc(length), length, width,
-                                                height, GL_RGBA, 0, GL_FLOAT,
-                                                GL_RGBA});
-      fbo->COLOR_ATTACHMENT0 = {AttachmentType::COLOR_ATTACHMENT0, 0, 0,
-                                texture};
-    }
-    // 初始化zbuffer
-    {
-      int length = sizeof(float) * width * height;
-      auto texture = new Texture();
-      texture->mips.push_back(new TextureBuffer{
-          malloc(length), length, width, height, GL_DEPTH_COMPONENT32F, 0,
-          GL_FLOAT, GL_DEPTH_COMPONENT32F});
-      fbo->DEPTH_ATTACHMENT = {AttachmentType::DEPTH_ATTACHMENT, 0, 0, texture};
-    }
-    glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
-  }
+  if (fbo == GLOBAL::DEFAULT_FRAMEBUFFER)
+    initDefaultFramebuffer(width, height);
 
   // TODO resize
   auto frameBufferTextureBuffer =
       fbo->COLOR_ATTACHMENT0.attachment->mips[fbo->COLOR_ATTACHMENT0.level];
-  auto zBuffer = static_cast<float *>(const_cast<void *>(
-      fbo->DEPTH_ATTACHMENT.attachment->mips[fbo->DEPTH_ATTACHMENT.level]
-          ->data));
+  auto depthTextureBuffer =
+      fbo->DEPTH_ATTACHMENT.attachment->mips[fbo->DEPTH_ATTACHMENT.level];
+  auto zBuffer =
+      static_cast<float *>(const_cast<void *>(depthTextureBuffer->data));
+  const int samples = frameBufferTextureBuffer->samples;
+  const vec2 *samplePositions =
+      samples > 1 ? MSAA4_SAMPLE_POSITIONS : CENTER_SAMPLE_POSITIONS;
+  uint8_t *stencilBuffer = nullptr;
+  TextureBuffer *stencilTextureBuffer = nullptr;
+  if (fbo->STENCIL_ATTACHMENT.attachment != nullptr) {
+    stencilTextureBuffer = fbo->STENCIL_ATTACHMENT.attachment
+                               ->mips[fbo->STENCIL_ATTACHMENT.level];
+    stencilBuffer = static_cast<uint8_t *>(
+        const_cast<void *>(stencilTextureBuffer->data));
+  }
+  // 各附件 samples 不一致时 framebuffer 不完整, 不绘制
+  if (depthTextureBuffer->samples != samples ||
+      (stencilTextureBuffer != nullptr &&
+       stencilTextureBuffer->samples != samples))
+    return;
 
   /**
-   * @brief 循环处理顶点
-   * 0. 读取attribute 设置到vertex shader
-   * 1. 执行vertex shader
-   * 2. 收集varying gl_Position
+   * @brief 解析attribute绑定, 所有instance共用
+   * 读取函数和步长已由vao预先解析, 这里只对应到shader变量
+   * divisor 不为0的attribute每个instance只读取一次
    */
-#pragma omp parallel for
-  for (int ii = 0; ii < count; ii++) {
-    int i = ii;
-    if (dataType == GL_UNSIGNED_SHORT)
-      i = indicesU16Ptr[ii];
-    if (dataType == GL_UNSIGNED_BYTE)
-      i = indicesU8Ptr[ii];
-
-    // 遍历shader里的attribute列表并更新每一轮的值
-    for (auto &[name, attr] : program->attributes) {
-      auto &info = vao->attributes[attr.location];
-      if (!info.enabled)
-        continue; // TODO 写入默认值
-
-      size_t componentLen;
-      size_t stride = info.stride;
-
-      switch (info.type) {
-      case GL_FLOAT:
-        componentLen = sizeof(float);
-        break;
-      case GL_UNSIGNED_BYTE:
-        componentLen = sizeof(uint8_t);
-        break;
+  vao->compile();
+  std::vector<AttributeBinding> vertexAttributes;
+  std::vector<AttributeBinding> instanceAttributes;
+  for (auto &[name, attr] : program->attributes) {
+    if (attr.location >= vao->attributes.size())
+      continue;
+    auto &info = vao->attributes[attr.location];
+    if (!info.enabled || info.fetch == nullptr || info.buffer == nullptr)
+      continue; // TODO 写入默认值
+
+    auto prop = vertexTypeInfo.get_property(name);
+    auto varPtr = prop.get_value(*vertexShader).get_value<float *>();
+    int varComponents = prop.get_metadata(1).get_value<int>() / sizeof(float);
+    if (varComponents < info.size)
+      continue;
+
+    // 缺少的分量按 (0, 0, 0, 1) 补齐, fetch 不会覆盖, 只需写一次
+    const float defaults[] = {0, 0, 0, 1};
+    for (int j = info.size; j < varComponents && j < 4; j++)
+      varPtr[j] = defaults[j];
+
+    auto base = static_cast<const uint8_t *>(info.buffer->data) + info.offset;
+    AttributeBinding binding{info.fetch, base, (size_t)info.byteStride,
+                             info.divisor, varPtr};
+    if (info.divisor == 0)
+      vertexAttributes.push_back(binding);
+    else
+      instanceAttributes.push_back(binding);
+  }
+
+  auto viewportMatrix = getViewportMatrix(viewport);
+  auto clipBox = getClipBox(width, height);
+  auto blendState = BlendState::from(state);
+  // 没有stencil buffer时stencil测试总是通过
+  auto stencilState = StencilState::from(state);
+  const bool stencilTest = stencilState.enabled && stencilBuffer != nullptr;
+  // 计数写入执行线程自己的 PipelineStatistics, glEndQuery 时合并
+  const bool statistics = statisticsEnabled();
+  const bool depthWrite = state->DEPTH_WRITEMASK;
+  const int colorWriteMask = state->COLOR_WRITEMASK & 0xf;
+  Heatmap *heatmap = state->HEATMAP_BINDING;
+  if (heatmap != nullptr)
+    heatmap->resize(width, height);
+
+  /**
+   * @brief 取不到 shader 的拷贝方式时整个绘制在调用线程上用原 shader 执行,
+   * 下面的并行都经过这两个函数
+   */
+  const ShaderCopyOps *vertexCopyOps = shaderCopyOps(vertexTypeInfo);
+  const ShaderCopyOps *fragmentCopyOps = shaderCopyOps(fragmentTypeInfo);
+  const bool cloneShaders =
+      vertexCopyOps != nullptr && fragmentCopyOps != nullptr;
+  auto parallelFor = [&](int count, int grain,
+                         const std::function<void(int, int)> &job) {
+    if (cloneShaders)
+      Jobs::parallelFor(count, grain, job);
+    else if (count > 0)
+      job(0, count);
+  };
+  auto forEachRow = [&](int rows, const std::function<void(int)> &job) {
+    if (cloneShaders)
+      forEachTileRow(rows, job);
+    else
+      for (int row = 0; row < rows; row++)
+        job(row);
+  };
+
+  // 每个 worker 一份, 本次绘制第一次使用时初始化
+  auto &storage = drawStorage();
+  const uint64_t drawId = ++storage.drawId;
+  auto &workers = storage.workers;
+  const size_t workerCount = Jobs::threadCount();
+  if (workers.size() < workerCount)
+    workers.resize(workerCount);
+  int vertexPass = 0;
+  const int tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+  const int tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+  // 分箱时逐行清空, 这里只保证数量足够
+  auto &tileBins = storage.tileBins;
+  const size_t tileCount = (size_t)tilesX * tilesY;
+  if (tileBins.size() < tileCount)
+    tileBins.resize(tileCount);
+  auto &triangleSetups = storage.triangleSetups;
+  auto &pointSetups = storage.pointSetups;
+  auto &lineSetups = storage.lineSetups;
+
+  // 每个子绘制重新填充, 容量在子绘制和绘制之间复用
+  auto &shadedVertices = storage.shadedVertices;
+  auto &elementSlots = storage.elementSlots;
+  std::vector<int> primitives;
+  auto &clipSpaceVertices = storage.clipSpaceVertices;
+  auto &pointSizes = storage.pointSizes;
+  auto &varyingMem = storage.varyingMem;
+  uint8_t *varyingMemU8 = nullptr;
+  // 第 slot 个已 shade 顶点的 varying
+  auto varyingAt = [&](int slot) {
+    return (float *)(varyingMemU8 + (size_t)slot * varyingSizeSumU8);
+  };
+
+  auto currentWorker = [&]() -> WorkerContext & {
+    auto &worker = workers[Jobs::workerIndex()];
+    if (worker.drawId == drawId)
+      return worker;
+    worker.drawId = drawId;
+    worker.vertexAttributes.clear();
+    worker.varyingLerped.resize(varyingSizeSumU8 / sizeof(float));
+    worker.vertexPass = vertexPass;
+    if (!cloneShaders) {
+      worker.vertexShader = vertexShader;
+      worker.fragmentShader = fragmentShader;
+      worker.vertexAttributes = vertexAttributes;
+      return worker;
+    }
+    worker.vertexShader = worker.vertexCopy.copy(*vertexShader, vertexCopyOps);
+    worker.fragmentShader =
+        worker.fragmentCopy.copy(*fragmentShader, fragmentCopyOps);
+    // attribute 写入的位置换到副本的同一成员
+    for (auto binding : vertexAttributes) {
+      binding.varPtr = (float *)((uint8_t *)worker.vertexShader +
+                                 ((uint8_t *)binding.varPtr -
+                                  (uint8_t *)vertexShader));
+      worker.vertexAttributes.push_back(binding);
+    }
+    return worker;
+  };
+
+  /**
+   * @brief 副本在每个 instance 开始后第一次使用时重新拷贝,
+   * 带上 gl_InstanceID 和 divisor 不为0的 attribute
+   */
+  auto vertexWorker = [&]() -> WorkerContext & {
+    auto &worker = currentWorker();
+    if (worker.vertexPass != vertexPass && cloneShaders) {
+      worker.vertexPass = vertexPass;
+      worker.vertexCopy.copy(*vertexShader, vertexCopyOps);
+    }
+    return worker;
+  };
+
+  /**
+   * @brief 处理一批fragment
+   * 0. 插值varying 执行fragment shader, 剔除discard的
+   * 1. 更新zBuffer stencil buffer
+   * 2. 混合后写入frameBuffer
+   */
+  auto flushPacket = [&](FragmentPacket &packet, float *varyingA,
+                         float *varyingB, float *varyingC,
+                         const StencilFace &stencilFace) {
+    CPPGL_TRACE("pipeline", "shade");
+    auto &worker = currentWorker();
+    ShaderSource *shader = worker.fragmentShader;
+    if (statistics)
+      threadStatistics().fragmentShaderInvocations += packet.count;
+    int shadedCount = 0;
+    for (int i = 0; i < packet.count; i++) {
+      vec3 bcClip = packet.bcClip[i];
+      // 插值varying(内存区块按照float插值)
+      for (size_t iF32 = 0, ilF32 = varyingSizeSumU8 / sizeof(float);
+           iF32 < ilF32; iF32++) {
+        vec3 v{*(varyingA + iF32), *(varyingB + iF32), *(varyingC + iF32)};
+        worker.varyingLerped[iF32] = v.lerpBarycentric(bcClip);
       }
+      // 设置到varying
+      size_t offsetU8 = 0;
+      for (auto &prop : fragmentTypeInfo.get_properties())
+        if (prop.get_metadata(0).get_value<ShaderSourceMeta>() ==
+            ShaderSourceMeta::Varying) {
+          auto var = prop.get_value(*shader);
+          auto varPtr = var.get_value<uint8_t *>();
+          auto sizeU8 = prop.get_metadata(1).get_value<int>();
 
-      if (stride == 0)
-        stride = info.size * componentLen;
-
-      auto ptr = static_cast<const char *>(info.buffer->data);
-      ptr += info.offset + stride * i;
-
-      // 写入attribute到shader的变量
-      auto prop = vertexTypeInfo.get_property(name);
-      auto var = prop.get_value(*vertexShader);
-      auto const varPtr = var.get_value<float *>();
-      if (info.type == GL_UNSIGNED_BYTE && info.normalized) {
-        auto varPtrI = varPtr;
-        for (int j = 0; j < info.size; j++) {
-          *varPtrI = static_cast<float>(*((uint8_t *)(ptr) + j)) / 255;
-          varPtrI++;
+          memcpy(varPtr, (uint8_t *)worker.varyingLerped.data() + offsetU8,
+                 sizeU8);
+          offsetU8 += sizeU8;
         }
-      } else {
-        memcpy(varPtr, ptr, stride);
+
+      if (packet.point)
+        shader->gl_PointCoord = packet.pointCoord[i];
+
+      // 执行fragment shader
+      shader->_discarded = false;
+      uint64_t shaderBegin = heatmap != nullptr ? readCycleCounter() : 0;
+      fragmentTypeInfo.get_method("main").invoke(*shader);
+      if (heatmap != nullptr) {
+        int pixel = packet.bufferIndex[i];
+        heatmap->shaderInvocations[pixel]++;
+        heatmap->shaderCycles[pixel] += readCycleCounter() - shaderBegin;
       }
-      auto sizeU8 = prop.get_metadata(1).get_value<int>();
-      if (sizeU8 == sizeof(vec4) && info.size == 3) {
-        *(varPtr + 3) = 1;
+      if (shader->_discarded) {
+        if (statistics)
+          threadStatistics().pixelsDiscarded++;
+        continue;
       }
-      if (sizeU8 == sizeof(vec4) && info.size == 2) {
-        *(varPtr + 2) = 0;
-        *(varPtr + 3) = 1;
+
+      packet.bufferIndex[shadedCount] = packet.bufferIndex[i];
+      packet.coverage[shadedCount] = packet.coverage[i];
+      memcpy(packet.depth[shadedCount], packet.depth[i],
+             sizeof(float) * samples);
+      packet.color[shadedCount] = clamp(shader->gl_FragColor, 0, 1);
+      shadedCount++;
+    }
+    packet.count = shadedCount;
+
+    // 更新zBuffer stencil buffer, 只写覆盖的sample
+    for (int i = 0; i < packet.count; i++)
+      for (int s = 0; s < samples; s++) {
+        if (!(packet.coverage[i] >> s & 1))
+          continue;
+        int sampleIndex = packet.bufferIndex[i] * samples + s;
+        if (depthWrite)
+          zBuffer[sampleIndex] = packet.depth[i][s];
+        if (stencilTest)
+          stencilFace.update(stencilFace.depthPass, stencilBuffer[sampleIndex]);
       }
-      if (sizeU8 == sizeof(vec4) && info.size == 1) {
-        *(varPtr + 1) = 0;
-        *(varPtr + 2) = 0;
-        *(varPtr + 3) = 1;
+
+    // 单采样直接写packet, 多重采样把颜色展开到每个覆盖的sample
+    int writeCount = packet.count;
+    const int *writeIndex = packet.bufferIndex;
+    vec4 *writeColor = packet.color;
+    int sampleIndices[FragmentPacket::SIZE * MAX_SAMPLES];
+    vec4 sampleColors[FragmentPacket::SIZE * MAX_SAMPLES];
+    if (samples > 1) {
+      writeCount = 0;
+      for (int i = 0; i < packet.count; i++)
+        for (int s = 0; s < samples; s++)
+          if (packet.coverage[i] >> s & 1) {
+            sampleIndices[writeCount] = packet.bufferIndex[i] * samples + s;
+            sampleColors[writeCount++] = packet.color[i];
+          }
+      writeIndex = sampleIndices;
+      writeColor = sampleColors;
+    }
+    if (statistics)
+      threadStatistics().pixelsWritten += writeCount;
+
+    // 颜色全部屏蔽时只更新深度和 stencil, 比如为遮挡查询绘制包围盒
+    if (colorWriteMask == 0) {
+      packet.count = 0;
+      return;
+    }
+    if (colorWriteMask != 0xf) {
+      // 屏蔽的通道保留 framebuffer 原有的值
+      vec4 dstColors[FragmentPacket::SIZE * MAX_SAMPLES];
+      vec4 outColors[FragmentPacket::SIZE * MAX_SAMPLES];
+      readColors(frameBufferTextureBuffer, writeIndex, dstColors, writeCount);
+      memcpy(outColors, blendState.enabled ? dstColors : writeColor,
+             sizeof(vec4) * writeCount);
+      if (blendState.enabled)
+        blendState.apply(writeColor, outColors, writeCount);
+      for (int i = 0; i < writeCount; i++)
+        for (int c = 0; c < 4; c++)
+          if (!(colorWriteMask >> c & 1))
+            (&outColors[i].r)[c] = (&dstColors[i].r)[c];
+      writeColors(frameBufferTextureBuffer, writeIndex, outColors, writeCount);
+    } else if (blendState.enabled) {
+      vec4 dstColors[FragmentPacket::SIZE * MAX_SAMPLES];
+      readColors(frameBufferTextureBuffer, writeIndex, dstColors, writeCount);
+      blendState.apply(writeColor, dstColors, writeCount);
+      writeColors(frameBufferTextureBuffer, writeIndex, dstColors, writeCount);
+    } else {
+      writeColors(frameBufferTextureBuffer, writeIndex, writeColor, writeCount);
+    }
+    packet.count = 0;
+  };
+
+  /**
+   * @brief 近远平面裁剪, stencil测试, 深度测试
+   * 都在插值varying和执行fragment shader之前完成
+   */
+  auto earlyTest = [&](int sampleIndex, float positionDepth,
+                       const StencilFace &stencilFace) {
+    if (statistics)
+      threadStatistics().pixelsTested++;
+    if (heatmap != nullptr)
+      heatmap->depthTests[sampleIndex / samples]++;
+    // 近远平面裁剪 TODO 确认
+    if (positionDepth < 0 || positionDepth > 1)
+      return false;
+
+    if (stencilTest && !stencilFace.test(stencilBuffer[sampleIndex])) {
+      stencilFace.update(stencilFace.fail, stencilBuffer[sampleIndex]);
+      return false;
+    }
+
+    // 或者深度大于已绘制的
+    if (state->DEPTH_TEST && zBuffer[sampleIndex] > positionDepth) {
+      if (statistics)
+        threadStatistics().pixelsDepthRejected++;
+      if (stencilTest)
+        stencilFace.update(stencilFace.depthFail, stencilBuffer[sampleIndex]);
+      return false;
+    }
+    return true;
+  };
+
+  /**
+   * @brief 点和线不逐sample计算覆盖, 覆盖像素时所有sample深度相同,
+   * 结果写入 packet 的下一个位置, 没有sample通过时返回 false
+   */
+  auto testSamples = [&](FragmentPacket &packet, int bufferIndex,
+                         float positionDepth, const StencilFace &stencilFace) {
+    uint8_t coverage = 0;
+    for (int s = 0; s < samples; s++)
+      if (earlyTest(bufferIndex * samples + s, positionDepth, stencilFace)) {
+        coverage |= 1 << s;
+        packet.depth[packet.count][s] = positionDepth;
       }
+    packet.coverage[packet.count] = coverage;
+    return coverage != 0;
+  };
+
+  /**
+   * @brief 点 setup: 以顶点为中心, 边长 gl_PointSize 的正方形,
+   * 像素中心落在正方形内才算覆盖
+   */
+  auto setupPoint = [&](int slot, PointSetup &setup) {
+    setup = {};
+    vec4 positionClip = clipSpaceVertices[slot];
+    if (positionClip.w <= 0) {
+      if (statistics)
+        threadStatistics().primitivesCulled++;
+      return;
+    }
+    vec4 center = viewportMatrix * positionClip / positionClip.w;
+    float size = std::max(pointSizes[slot], 1.f);
+    float left = center.x - size / 2;
+    float bottom = center.y - size / 2;
+    int minX = std::max((int)std::ceil(left - 0.5f), (int)clipBox.min.x);
+    int minY = std::max((int)std::ceil(bottom - 0.5f), (int)clipBox.min.y);
+    int maxX = std::min((int)std::ceil(left + size - 0.5f), (int)clipBox.max.x);
+    int maxY =
+        std::min((int)std::ceil(bottom + size - 0.5f), (int)clipBox.max.y);
+    if (statistics) {
+      if (minX >= maxX || minY >= maxY)
+        threadStatistics().primitivesCulled++;
+      else if (left < clipBox.min.x || bottom < clipBox.min.y ||
+               left + size > clipBox.max.x || bottom + size > clipBox.max.y)
+        threadStatistics().primitivesClipped++;
     }
+    setup = {varyingAt(slot),
+             left,
+             bottom,
+             size,
+             1 - positionClip.z / positionClip.w,
+             minX,
+             minY,
+             maxX,
+             maxY};
+  };
+
+  /**
+   * @brief 光栅化点落在 tile (tileX, tileY) 内的部分
+   * 覆盖的像素深度相同, varying 直接取顶点的值
+   */
+  auto rasterizePoint = [&](const PointSetup &setup, int tileX, int tileY) {
+    int minX = std::max(setup.minX, tileX);
+    int minY = std::max(setup.minY, tileY);
+    int maxX = std::min(setup.maxX, tileX + TILE_SIZE);
+    int maxY = std::min(setup.maxY, tileY + TILE_SIZE);
+    float *varying = setup.varying;
 
-    // 执行vertex shader
-    vertexTypeInfo.get_method("main").invoke(vertexShader);
-
-    // 收集gl_Position
-    clipSpaceVertices[ii] = vertexShader->gl_Position;
-
-    // 收集varying
-    size_t offsetU8 = 0;
-    for (auto &prop : vertexTypeInfo.get_properties()) {
-      if (prop.get_metadata(0).get_value<ShaderSourceMeta>() ==
-          ShaderSourceMeta::Varying) {
-        auto src = prop.get_value(*vertexShader).get_value<uint8_t *>();
-        auto dst = varyingMemU8 + (ii * varyingSizeSumU8) + offsetU8;
-        auto sizeU8 = prop.get_metadata(1).get_value<int>();
-        memcpy(dst, src, sizeU8);
-        offsetU8 += sizeU8;
+    FragmentPacket packet;
+    packet.point = true;
+    for (int y = minY; y < maxY; y++) {
+      for (int x = minX; x < maxX; x++) {
+        int bufferIndex = x + y * width;
+        if (!testSamples(packet, bufferIndex, setup.depth, stencilState.front))
+          continue;
+
+        packet.bufferIndex[packet.count] = bufferIndex;
+        packet.bcClip[packet.count] = {1, 0, 0};
+        // 原点在左上角
+        packet.pointCoord[packet.count] = {
+            (x + 0.5f - setup.left) / setup.size,
+            1 - (y + 0.5f - setup.bottom) / setup.size};
+        if (++packet.count == FragmentPacket::SIZE)
+          flushPacket(packet, varying, varying, varying, stencilState.front);
       }
     }
-  }
+    if (packet.count != 0)
+      flushPacket(packet, varying, varying, varying, stencilState.front);
+  };
 
-  auto viewportMatrix = getViewportMatrix(viewport);
+  /**
+   * @brief 线段 setup: 沿主轴逐像素步进, 每一步一个fragment (线宽为1)
+   * 经过的像素都在两个端点所在像素围成的范围内, 以此分箱
+   */
+  auto setupLine = [&](int slotA, int slotB, LineSetup &setup) {
+    setup = {};
+    vec4 clipA = clipSpaceVertices[slotA];
+    vec4 clipB = clipSpaceVertices[slotB];
+    if (clipA.w <= 0 || clipB.w <= 0) {
+      if (statistics)
+        threadStatistics().primitivesCulled++;
+      return;
+    }
+    vec4 a = viewportMatrix * clipA / clipA.w;
+    vec4 b = viewportMatrix * clipB / clipB.w;
+    float dx = b.x - a.x;
+    float dy = b.y - a.y;
+    bool xMajor = std::abs(dx) >= std::abs(dy);
+    float majorA = xMajor ? a.x : a.y;
+    float majorB = xMajor ? b.x : b.y;
+    float delta = majorB - majorA;
+    if (delta == 0) {
+      if (statistics)
+        threadStatistics().primitivesCulled++;
+      return;
+    }
+    box2 lineBox;
+    lineBox.expandByPoint({a.x, a.y});
+    lineBox.expandByPoint({b.x, b.y});
+    if (statistics) {
+      if (lineBox.max.x <= clipBox.min.x || lineBox.min.x >= clipBox.max.x ||
+          lineBox.max.y <= clipBox.min.y || lineBox.min.y >= clipBox.max.y)
+        threadStatistics().primitivesCulled++;
+      else if (lineBox.min.x < clipBox.min.x || lineBox.min.y < clipBox.min.y ||
+               lineBox.max.x > clipBox.max.x || lineBox.max.y > clipBox.max.y)
+        threadStatistics().primitivesClipped++;
+    }
+    // 主轴上像素中心落在 [min, max) 内, strip 相接处不会重复绘制
+    int begin = (int)std::ceil(std::min(majorA, majorB) - 0.5f);
+    int end = (int)std::ceil(std::max(majorA, majorB) - 0.5f);
+    setup = {varyingAt(slotA),
+             varyingAt(slotB),
+             {a.x, a.y},
+             dx,
+             dy,
+             clipA.w,
+             clipB.w,
+             clipA.z / clipA.w,
+             clipB.z / clipB.w,
+             xMajor,
+             majorA,
+             delta,
+             begin,
+             end,
+             std::max((int)std::floor(lineBox.min.x), (int)clipBox.min.x),
+             std::max((int)std::floor(lineBox.min.y), (int)clipBox.min.y),
+             std::min((int)std::floor(lineBox.max.x) + 1, (int)clipBox.max.x),
+             std::min((int)std::floor(lineBox.max.y) + 1, (int)clipBox.max.y)};
+  };
 
-  if (mode == GL_TRIANGLES) {
-#pragma omp parallel for
-    for (int vertexIndex = 0; vertexIndex < count; vertexIndex += 3) {
-      triangle triangleClip{clipSpaceVertices[vertexIndex],
-                            clipSpaceVertices[vertexIndex + 1],
-                            clipSpaceVertices[vertexIndex + 2]};
-      float *varyingA =
-          (float *)(varyingMemU8 + vertexIndex * varyingSizeSumU8);
-      float *varyingB =
-          (float *)(varyingMemU8 + (vertexIndex + 1) * varyingSizeSumU8);
-      float *varyingC =
-          (float *)(varyingMemU8 + (vertexIndex + 2) * varyingSizeSumU8);
-      /**
-       * @brief 透视除法
-       */
-      if (triangleClip.a.w == 0)
-        assert(triangleClip.a.w != 0);
-      vec3 triangleClipVecW{if0Be1(triangleClip.a.w), if0Be1(triangleClip.b.w),
-                            if0Be1(triangleClip.c.w)};
-      vec3 triangleClipVecZ{triangleClip.a.z, triangleClip.b.z,
-                            triangleClip.c.z};
-      // 把齐次坐标系下转为正常坐标系 TODO 理解
-      vec3 triangleClipVecZDivZ = triangleClipVecZ / triangleClipVecW;
-      triangle triangleViewport = triangleClip * viewportMatrix;
-      triangle triangleProjDiv =
-          triangleViewport.perspectiveDivide(triangleClipVecW);
-      /**
-       * @brief 寻找三角形bounding box
-       */
-      box2 boundingBox = triangleProjDiv.viewportBoundingBox(viewport);
-// box2 boundingBox = {{0, 0}, {(float)width, (float)height}};
-// std::cout << boundingBox << std::endl;
-// std::cout << "triangleClipVecZ:" << triangleClipVecZ << std::endl;
-/**
- * @brief 光栅化rasterization
- */
-#pragma omp parallel for
-      for (int y = (int)boundingBox.min.y; y < (int)boundingBox.max.y; y++) {
-        for (int x = (int)boundingBox.min.x; x < (int)boundingBox.max.x; x++) {
-          int bufferIndex = x + y * width;
-          vec2 positionViewport{(float)x + 0.5f, (float)y + 0.5f};
-          vec3 bcScreen = triangleProjDiv.getBarycentric(positionViewport);
+  /**
+   * @brief 光栅化线段落在 tile (tileX, tileY) 内的部分
+   * 用线段参数 t 做透视校正插值, 不计算三角形重心坐标
+   */
+  auto rasterizeLine = [&](const LineSetup &setup, int tileX, int tileY) {
+    int minX = std::max(setup.minX, tileX);
+    int minY = std::max(setup.minY, tileY);
+    int maxX = std::min(setup.maxX, tileX + TILE_SIZE);
+    int maxY = std::min(setup.maxY, tileY + TILE_SIZE);
+    int begin = std::max(setup.begin, setup.xMajor ? minX : minY);
+    int end = std::min(setup.end, setup.xMajor ? maxX : maxY);
+
+    FragmentPacket packet;
+    for (int major = begin; major < end; major++) {
+      float t = (major + 0.5f - setup.majorA) / setup.delta;
+      int x = setup.xMajor ? major : (int)std::floor(setup.a.x + t * setup.dx);
+      int y = setup.xMajor ? (int)std::floor(setup.a.y + t * setup.dy) : major;
+      if (x < minX || x >= maxX || y < minY || y >= maxY)
+        continue;
+
+      // 屏幕空间的 t 转为透视校正的 t
+      float tClip = t / setup.wB / ((1 - t) / setup.wA + t / setup.wB);
+      float positionDepth =
+          1 - (setup.depthA + (setup.depthB - setup.depthA) * tClip);
+      int bufferIndex = x + y * width;
+      if (!testSamples(packet, bufferIndex, positionDepth, stencilState.front))
+        continue;
+
+      packet.bufferIndex[packet.count] = bufferIndex;
+      packet.bcClip[packet.count] = {1 - tClip, tClip, 0};
+      if (++packet.count == FragmentPacket::SIZE)
+        flushPacket(packet, setup.varyingA, setup.varyingB, setup.varyingA,
+                    stencilState.front);
+    }
+    if (packet.count != 0)
+      flushPacket(packet, setup.varyingA, setup.varyingB, setup.varyingA,
+                  stencilState.front);
+  };
+
+  /**
+   * @brief 三角形 setup: 透视除法, bounding box, 正反面
+   * 各三角形互不依赖, 结果写入 setup 供分箱和各 tile 使用
+   */
+  auto setupTriangle = [&](int t, TriangleSetup &setup) {
+    const int slotA = primitives[t];
+    const int slotB = primitives[t + 1];
+    const int slotC = primitives[t + 2];
+    triangle triangleClip{clipSpaceVertices[slotA], clipSpaceVertices[slotB],
+                          clipSpaceVertices[slotC]};
+    float *varyingA = varyingAt(slotA);
+    float *varyingB = varyingAt(slotB);
+    float *varyingC = varyingAt(slotC);
+    /**
+     * @brief 透视除法
+     */
+    if (triangleClip.a.w == 0)
+      assert(triangleClip.a.w != 0);
+    vec3 triangleClipVecW{if0Be1(triangleClip.a.w), if0Be1(triangleClip.b.w),
+                          if0Be1(triangleClip.c.w)};
+    vec3 triangleClipVecZ{triangleClip.a.z, triangleClip.b.z,
+                          triangleClip.c.z};
+    // 把齐次坐标系下转为正常坐标系 TODO 理解
+    vec3 triangleClipVecZDivZ = triangleClipVecZ / triangleClipVecW;
+    triangle triangleViewport = triangleClip * viewportMatrix;
+    triangle triangleProjDiv =
+        triangleViewport.perspectiveDivide(triangleClipVecW);
+    /**
+     * @brief 寻找三角形bounding box
+     */
+    box2 boundingBox = triangleProjDiv.viewportBoundingBox(clipBox);
+    /**
+     * @brief 逆时针为正面, 选择对应的stencil参数
+     */
+    float signedArea =
+        cross(vec2{triangleProjDiv.b.x - triangleProjDiv.a.x,
+                   triangleProjDiv.b.y - triangleProjDiv.a.y},
+              vec2{triangleProjDiv.c.x - triangleProjDiv.a.x,
+                   triangleProjDiv.c.y - triangleProjDiv.a.y});
+    bool frontFacing = signedArea >= 0;
+    // 多重采样时 sample 可能落在像素中心之外, 包含边界所在的像素
+    int maxX = (int)boundingBox.max.x;
+    int maxY = (int)boundingBox.max.y;
+    if (samples > 1) {
+      maxX = std::min((int)std::ceil(boundingBox.max.x), (int)clipBox.max.x);
+      maxY = std::min((int)std::ceil(boundingBox.max.y), (int)clipBox.max.y);
+    }
+    if (statistics) {
+      // 未与 clipBox 求交的范围, 用于区分被裁剪的图元
+      box2 fullBox;
+      fullBox.expandByPoint({triangleProjDiv.a.x, triangleProjDiv.a.y});
+      fullBox.expandByPoint({triangleProjDiv.b.x, triangleProjDiv.b.y});
+      fullBox.expandByPoint({triangleProjDiv.c.x, triangleProjDiv.c.y});
+      if ((int)boundingBox.min.x >= maxX || (int)boundingBox.min.y >= maxY ||
+          signedArea == 0)
+        threadStatistics().primitivesCulled++;
+      else if (fullBox.min.x < clipBox.min.x || fullBox.min.y < clipBox.min.y ||
+               fullBox.max.x > clipBox.max.x || fullBox.max.y > clipBox.max.y)
+        threadStatistics().primitivesClipped++;
+    }
+    setup = {varyingA,
+             varyingB,
+             varyingC,
+             triangleProjDiv,
+             triangleClipVecW,
+             triangleClipVecZDivZ,
+             (int)boundingBox.min.x,
+             (int)boundingBox.min.y,
+             maxX,
+             maxY,
+             frontFacing};
+  };
+
+  /**
+   * @brief 光栅化三角形落在 tile (tileX, tileY) 内的部分
+   */
+  auto rasterizeTriangle = [&](TriangleSetup &setup, int tileX, int tileY) {
+    const StencilFace &stencilFace =
+        setup.frontFacing ? stencilState.front : stencilState.back;
+    int minX = std::max(setup.minX, tileX);
+    int minY = std::max(setup.minY, tileY);
+    int maxX = std::min(setup.maxX, tileX + TILE_SIZE);
+    int maxY = std::min(setup.maxY, tileY + TILE_SIZE);
+    for (int y = minY; y < maxY; y++) {
+      FragmentPacket packet;
+      for (int x = minX; x < maxX; x++) {
+        int bufferIndex = x + y * width;
+        vec3 bcClip;
+        uint8_t coverage = 0;
+        // 逐sample判断覆盖并插值深度, 单采样时只有像素中心一个sample
+        for (int s = 0; s < samples; s++) {
+          vec2 positionViewport{x + samplePositions[s].x,
+                                y + samplePositions[s].y};
+          vec3 bcScreen = setup.projDiv.getBarycentric(positionViewport);
 
           // 不在三角形内 (TODO 理解)
           if (bcScreen.x < 0 || bcScreen.y < 0 || bcScreen.z < 0)
             continue;
-          // if (!triangleViewport.contains(positionViewport))
-          //   continue;
 
-          vec3 bcClip = bcScreen / triangleClipVecW;
+          vec3 bcSample = bcScreen / setup.clipVecW;
           // TODO 这里还是不懂
-          bcClip = bcClip / (bcClip.x + bcClip.y + bcClip.z);
+          bcSample = bcSample / (bcSample.x + bcSample.y + bcSample.z);
 
           // 插值得到深度 TODO 理解为什么需要1-z
           float positionDepth =
-              1 - triangleClipVecZDivZ.lerpBarycentric(bcClip);
-          float zBufferDepth = zBuffer[bufferIndex];
+              1 - setup.clipVecZDivZ.lerpBarycentric(bcSample);
 
-          // 近远平面裁剪 TODO 确认
-          if (positionDepth < 0 || positionDepth > 1)
+          if (!earlyTest(bufferIndex * samples + s, positionDepth, stencilFace))
             continue;
+          coverage |= 1 << s;
+          packet.depth[packet.count][s] = positionDepth;
+          bcClip = bcSample;
+        }
+        if (coverage == 0)
+          continue;
 
-          // 或者深度大于已绘制的
-          if (state->DEPTH_TEST && zBufferDepth > positionDepth)
-            continue;
+        // 多重采样每个像素只在中心执行一次 fragment shader
+        if (samples > 1) {
+          vec2 positionViewport{x + 0.5f, y + 0.5f};
+          bcClip = setup.projDiv.getBarycentric(positionViewport) /
+                   setup.clipVecW;
+          bcClip = bcClip / (bcClip.x + bcClip.y + bcClip.z);
+        }
 
-          // 插值varying(内存区块按照float插值)
-          for (int iF32 = 0, ilF32 = varyingSizeSumU8 / sizeof(float);
-               iF32 < ilF32; iF32++) {
-            vec3 v{*(varyingA + iF32), *(varyingB + iF32), *(varyingC + iF32)};
-            *((float *)(varyingLerpedMemU8) + iF32) = v.lerpBarycentric(bcClip);
-          }
-          // 设置到varying
-          int offsetU8 = 0;
-          for (auto &prop : fragmentTypeInfo.get_properties())
+        packet.bufferIndex[packet.count] = bufferIndex;
+        packet.coverage[packet.count] = coverage;
+        packet.bcClip[packet.count] = bcClip;
+        if (++packet.count == FragmentPacket::SIZE)
+          flushPacket(packet, setup.varyingA, setup.varyingB, setup.varyingC,
+                      stencilFace);
+      }
+      if (packet.count != 0)
+        flushPacket(packet, setup.varyingA, setup.varyingB, setup.varyingC,
+                    stencilFace);
+    }
+  };
+
+  CPPGL_TRACE_END(setup);
+
+  /**
+   * @brief 逐个子绘制执行, 上面的准备工作所有子绘制共用一次
+   * 每个子绘制内逐个instance执行, 顶点收集和图元装配只做一次
+   */
+  for (int commandIndex = 0; commandIndex < commandCount; commandIndex++) {
+    const DrawCommand &command = commands[commandIndex];
+    const void *indicesPtr = command.indices;
+    if (indicesPtr == nullptr && vao->indexBuffer != nullptr)
+      indicesPtr = vao->indexBuffer->data;
+
+    CPPGL_TRACE_BEGIN(assemble, "pipeline", "assemble");
+    collectVertices(command, dataType, indicesPtr, restartIndex,
+                    shadedVertices, elementSlots);
+    primitives = assemblePrimitives(mode, elementSlots);
+    CPPGL_TRACE_END(assemble);
+    const int shadedCount = shadedVertices.size();
+    clipSpaceVertices.resize(shadedCount);
+    if (mode == GL_POINTS)
+      pointSizes.resize(shadedCount);
+    varyingMem.resize(varyingSizeSumU8 * (size_t)shadedCount);
+    varyingMemU8 = varyingMem.data();
+
+    for (int instanceId = 0; instanceId < command.instanceCount; instanceId++) {
+      vertexShader->gl_InstanceID = instanceId;
+      for (auto &binding : instanceAttributes)
+        binding.fetchAt(command.baseInstance + instanceId / binding.divisor);
+
+      /**
+       * @brief 循环处理顶点
+       * 0. 读取attribute 设置到vertex shader
+       * 1. 执行vertex shader
+       * 2. 收集varying gl_Position
+       */
+      CPPGL_TRACE_BEGIN(vertex, "pipeline", "vertex");
+      Perf::StageScope vertexStage(PerfStage::VERTEX);
+      vertexPass++;
+      parallelFor(shadedCount, VERTEX_GRAIN, [&](int begin, int end) {
+        Perf::StageScope workerStage(PerfStage::VERTEX);
+        auto &worker = vertexWorker();
+        ShaderSource *shader = worker.vertexShader;
+        for (int slot = begin; slot < end; slot++) {
+          int64_t i = shadedVertices[slot];
+
+          // 更新每一轮的attribute
+          for (auto &binding : worker.vertexAttributes)
+            binding.fetchAt(i);
+
+          // 执行vertex shader
+          vertexTypeInfo.get_method("main").invoke(shader);
+
+          // 收集gl_Position
+          clipSpaceVertices[slot] = shader->gl_Position;
+          if (mode == GL_POINTS)
+            pointSizes[slot] = shader->gl_PointSize;
+
+          // 收集varying
+          size_t offsetU8 = 0;
+          for (auto &prop : vertexTypeInfo.get_properties()) {
             if (prop.get_metadata(0).get_value<ShaderSourceMeta>() ==
                 ShaderSourceMeta::Varying) {
-              auto var = prop.get_value(*fragmentShader);
-              auto varPtr = var.get_value<uint8_t *>();
+              auto src = prop.get_value(*shader).get_value<uint8_t *>();
+              auto dst = (uint8_t *)varyingAt(slot) + offsetU8;
               auto sizeU8 = prop.get_metadata(1).get_value<int>();
-
-              memcpy(varPtr, varyingLerpedMemU8 + offsetU8, sizeU8);
+              memcpy(dst, src, sizeU8);
               offsetU8 += sizeU8;
             }
+          }
+        }
+      });
+      CPPGL_TRACE_END(vertex);
+      vertexStage.end();
+      if (statistics) {
+        threadStatistics().verticesShaded += shadedCount;
+        threadStatistics().primitivesSubmitted +=
+            primitives.size() / vertexPerPrimitive;
+      }
 
-          // 执行fragment shader
-          fragmentShader->_discarded = false;
-          fragmentTypeInfo.get_method("main").invoke(*fragmentShader);
-          if (fragmentShader->_discarded)
-            continue;
+      // 到本 instance 结束, 包含其中 shade 的耗时
+      CPPGL_TRACE("pipeline", "raster");
+      Perf::StageScope rasterStage(PerfStage::RASTER);
 
-          auto color = clamp(fragmentShader->gl_FragColor, 0, 1);
-
-          // 更新zBuffer frameBuffer
-          zBuffer[bufferIndex] = positionDepth;
-
-          if (frameBufferTextureBuffer->internalFormat == GL_RGBA) {
-            if (frameBufferTextureBuffer->dataType == GL_FLOAT) {
-              vec4 *frameBuffer = (vec4 *)frameBufferTextureBuffer->data;
-              frameBuffer[bufferIndex] = color;
-            } else if (frameBufferTextureBuffer->dataType == GL_UNSIGNED_BYTE) {
-              uint8_t *frameBuffer = (uint8_t *)frameBufferTextureBuffer->data;
-              frameBuffer[bufferIndex * 4] = (uint8_t)(color.r * 255);
-              frameBuffer[bufferIndex * 4 + 1] = (uint8_t)(color.g * 255);
-              frameBuffer[bufferIndex * 4 + 2] = (uint8_t)(color.b * 255);
-              frameBuffer[bufferIndex * 4 + 3] = (uint8_t)(color.a * 255);
-            }
+      /**
+       * @brief 图元先 setup 再按 tile 分箱, tile 之间没有共享的像素,
+       * 每个 tile 内按图元顺序光栅化, 所以并行的结果与逐个图元顺序绘制
+       * 完全一致, 与线程数无关
+       */
+      const int primitiveCount = primitives.size() / vertexPerPrimitive;
+      CPPGL_TRACE_BEGIN(bin, "pipeline", "bin");
+      auto setupPrimitives = [&](auto &setups, auto &&setupOne) {
+        setups.resize(primitiveCount);
+        parallelFor(primitiveCount, SETUP_GRAIN, [&](int begin, int end) {
+          Perf::StageScope workerStage(PerfStage::RASTER);
+          for (int t = begin; t < end; t++)
+            setupOne(t * vertexPerPrimitive, setups[t]);
+        });
+      };
+      // 每个任务负责一行 tile, 按图元顺序扫描, 各行的分箱互不影响
+      auto binPrimitives = [&](const auto &setups) {
+        forEachRow(tilesY, [&](int ty) {
+          Perf::StageScope workerStage(PerfStage::RASTER);
+          for (int tx = 0; tx < tilesX; tx++)
+            tileBins[tx + ty * tilesX].clear();
+          for (int t = 0; t < primitiveCount; t++) {
+            auto &setup = setups[t];
+            if (setup.minX >= setup.maxX || setup.minY >= setup.maxY ||
+                setup.minY / TILE_SIZE > ty ||
+                (setup.maxY - 1) / TILE_SIZE < ty)
+              continue;
+            for (int tx = setup.minX / TILE_SIZE;
+                 tx <= (setup.maxX - 1) / TILE_SIZE; tx++)
+              tileBins[tx + ty * tilesX].push_back(t);
           }
-        }
+        });
+      };
+      if (vertexPerPrimitive == 1) {
+        setupPrimitives(pointSetups, [&](int p, PointSetup &setup) {
+          setupPoint(primitives[p], setup);
+        });
+        binPrimitives(pointSetups);
+      } else if (vertexPerPrimitive == 2) {
+        setupPrimitives(lineSetups, [&](int p, LineSetup &setup) {
+          setupLine(primitives[p], primitives[p + 1], setup);
+        });
+        binPrimitives(lineSetups);
+      } else {
+        setupPrimitives(triangleSetups, setupTriangle);
+        binPrimitives(triangleSetups);
       }
+      CPPGL_TRACE_END(bin);
+
+      auto rasterizeTile = [&](int tile) {
+        if (tileBins[tile].empty())
+          return;
+        CPPGL_TRACE("pipeline", "tile");
+        // 每个 tile 切换一次阶段, 每批 fragment 都切换时读计数器的
+        // 系统调用会盖过要测量的开销
+        Perf::StageScope tileStage(PerfStage::FRAGMENT);
+        int tileX = tile % tilesX * TILE_SIZE;
+        int tileY = tile / tilesX * TILE_SIZE;
+        for (int t : tileBins[tile])
+          if (vertexPerPrimitive == 1)
+            rasterizePoint(pointSetups[t], tileX, tileY);
+          else if (vertexPerPrimitive == 2)
+            rasterizeLine(lineSetups[t], tileX, tileY);
+          else
+            rasterizeTriangle(triangleSetups[t], tileX, tileY);
+      };
+      // NUMA 绑定时 tile 行固定由写过这段内存的 worker 光栅化, 否则逐 tile 窃取
+      if (Jobs::numaAffinity())
+        forEachRow(tilesY, [&](int ty) {
+          for (int tx = 0; tx < tilesX; tx++)
+            rasterizeTile(tx + ty * tilesX);
+        });
+      else
+        parallelFor(tilesX * tilesY, 1, [&](int begin, int end) {
+          for (int tile = begin; tile < end; tile++)
+            rasterizeTile(tile);
+        });
     }
   }
-
-  delete varyingMemU8;
-  delete varyingLerpedMemU8;
 }
 } // namespace CppGL::Helper
\ No newline at end of file
@@ -0,0 +1,350 @@
+#include <CppGL/job-system.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace CppGL::Jobs {
+namespace {
+struct Batch {
+  const std::function<void(int, int)> *job;
+  std::atomic<int> remaining{0};
+};
+
+struct Task {
+  Batch *batch;
+  int begin;
+  int end;
+};
+
+struct Queue {
+  std::mutex mutex;
+  std::deque<Task> tasks;
+  // 固定归属的任务, 只由队列所属的 worker 执行
+  std::deque<Task> owned;
+  std::atomic<int> ownedPending{0};
+};
+
+// 扫描 /sys/devices/system/node/node<N> 的上限
+const int MAX_NUMA_NODES = 64;
+
+struct Pool {
+  // 0 表示使用硬件线程数
+  int count = 0;
+  std::vector<int> cpus;
+  bool numa = false;
+  bool topologyLoaded = false;
+  // 每个节点的 cpu 列表
+  std::vector<std::vector<int>> nodes;
+  // start 时确定的每个 worker 绑定的 cpu, -1 为不绑定
+  std::vector<int> workerCpus;
+  bool started = false;
+  bool stopping = false;
+  // queues[0] 属于发起并行的线程
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> threads;
+  // 已入队还未被取走的任务数, worker 为0时休眠
+  std::atomic<int> pending{0};
+  std::mutex sleepMutex;
+  std::condition_variable wake;
+
+  void start();
+  void stop();
+};
+
+// 不在进程退出时析构: worker 退出时 thread_local 的析构会用到其他模块的
+// 静态对象, 它们可能已经先析构了
+Pool &pool = *new Pool;
+thread_local int currentWorker = 0;
+
+void loadTopology() {
+  if (pool.topologyLoaded)
+    return;
+  pool.topologyLoaded = true;
+#ifdef __linux__
+  for (int node = 0; node < MAX_NUMA_NODES; node++) {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+             node);
+    FILE *file = fopen(path, "r");
+    if (file == nullptr)
+      continue;
+    // 格式如 0-3,8-11
+    std::vector<int> cpus;
+    int first = 0;
+    while (fscanf(file, "%d", &first) == 1) {
+      int last = first;
+      int separator = fgetc(file);
+      if (separator == '-' && fscanf(file, "%d", &last) == 1)
+        separator = fgetc(file);
+      for (int cpu = first; cpu <= last; cpu++)
+        cpus.push_back(cpu);
+      if (separator != ',')
+        break;
+    }
+    fclose(file);
+    if (!cpus.empty())
+      pool.nodes.push_back(cpus);
+  }
+#endif
+}
+
+/**
+ * @brief NUMA 模式下 worker i 属于节点 i * 节点数 / 线程数,
+ * 在节点内依次使用各个 cpu, 节点0的第一个 cpu 留给调用线程
+ */
+void assignCpus(int total) {
+  pool.workerCpus.assign(total, -1);
+  if (pool.numa) {
+    loadTopology();
+    int nodeCount = pool.nodes.size();
+    if (nodeCount == 0)
+      return;
+    std::vector<int> used(nodeCount, 0);
+    used[0] = 1;
+    for (int i = 1; i < total; i++) {
+      int node = (int)((int64_t)i * nodeCount / total);
+      auto &cpus = pool.nodes[node];
+      pool.workerCpus[i] = cpus[used[node]++ % cpus.size()];
+    }
+  } else if (!pool.cpus.empty()) {
+    for (int i = 1; i < total; i++)
+      pool.workerCpus[i] = pool.cpus[(i - 1) % pool.cpus.size()];
+  }
+}
+
+void pinCurrentThread(int index) {
+#ifdef __linux__
+  int cpu = pool.workerCpus[index];
+  if (cpu < 0)
+    return;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+}
+
+bool take(int index, Task &task) {
+  // 自己的队列后进先出, 刚放入的区间数据更可能还在缓存里
+  {
+    auto &queue = *pool.queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.owned.empty()) {
+      task = queue.owned.front();
+      queue.owned.pop_front();
+      queue.ownedPending--;
+      return true;
+    }
+    if (!queue.tasks.empty()) {
+      task = queue.tasks.back();
+      queue.tasks.pop_back();
+      pool.pending--;
+      return true;
+    }
+  }
+  int count = pool.queues.size();
+  for (int i = 1; i < count; i++) {
+    auto &queue = *pool.queues[(index + i) % count];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = queue.tasks.front();
+      queue.tasks.pop_front();
+      pool.pending--;
+      return true;
+    }
+  }
+  return false;
+}
+
+void run(const Task &task) {
+  (*task.batch->job)(task.begin, task.end);
+  task.batch->remaining.fetch_sub(1, std::memory_order_release);
+}
+
+void workerLoop(int index) {
+  currentWorker = index;
+  pinCurrentThread(index);
+  while (true) {
+    Task task;
+    if (take(index, task)) {
+      run(task);
+      continue;
+    }
+    auto &queue = *pool.queues[index];
+    std::unique_lock<std::mutex> lock(pool.sleepMutex);
+    pool.wake.wait(lock, [&] {
+      return pool.stopping || pool.pending > 0 || queue.ownedPending > 0;
+    });
+    if (pool.stopping)
+      return;
+  }
+}
+
+void Pool::start() {
+  if (started)
+    return;
+  started = true;
+  int total = threadCount();
+  assignCpus(total);
+  queues.clear();
+  for (int i = 0; i < total; i++)
+    queues.push_back(std::make_unique<Queue>());
+  for (int i = 1; i < total; i++)
+    threads.emplace_back(workerLoop, i);
+}
+
+void Pool::stop() {
+  if (!started)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto &thread : threads)
+    thread.join();
+  threads.clear();
+  queues.clear();
+  stopping = false;
+  started = false;
+}
+} // namespace
+
+void setThreadCount(int count) {
+  count = std::max(count, 1);
+  if (count == pool.count)
+    return;
+  pool.stop();
+  pool.count = count;
+}
+
+int threadCount() {
+  if (pool.count == 0)
+    return std::max((int)std::thread::hardware_concurrency(), 1);
+  return pool.count;
+}
+
+void setAffinity(const std::vector<int> &cpus) {
+  pool.stop();
+  pool.cpus = cpus;
+}
+
+void setNumaAffinity(bool enabled) {
+  if (enabled == pool.numa)
+    return;
+  pool.stop();
+  pool.numa = enabled;
+}
+
+bool numaAffinity() { return pool.numa; }
+
+int nodeCount() {
+  loadTopology();
+  return std::max((int)pool.nodes.size(), 1);
+}
+
+int workerIndex() { return currentWorker; }
+
+void parallelFor(int count, int grain,
+                 const std::function<void(int begin, int end)> &job) {
+  if (count <= 0)
+    return;
+  grain = std::max(grain, 1);
+  const int threads = threadCount();
+  if (threads == 1 || count <= grain) {
+    job(0, count);
+    return;
+  }
+  pool.start();
+
+  // 连续的区间放入同一个队列, 每个线程先处理相邻的数据
+  Batch batch;
+  batch.job = &job;
+  const int chunks = (count + grain - 1) / grain;
+  batch.remaining = chunks;
+  const int self = currentWorker;
+  for (int q = 0; q < threads; q++) {
+    int first = (int)((int64_t)chunks * q / threads);
+    int last = (int)((int64_t)chunks * (q + 1) / threads);
+    auto &queue = *pool.queues[(self + q) % threads];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    // 自己的队列从尾部取, 倒序放入使区间按顺序执行
+    for (int chunk = last - 1; chunk >= first; chunk--)
+      queue.tasks.push_back(
+          {&batch, chunk * grain, std::min((chunk + 1) * grain, count)});
+  }
+  {
+    std::lock_guard<std::mutex> lock(pool.sleepMutex);
+    pool.pending += chunks;
+  }
+  pool.wake.notify_all();
+
+  while (batch.remaining.load(std::memory_order_acquire) > 0) {
+    Task task;
+    if (take(self, task))
+      run(task);
+    else
+      std::this_thread::yield();
+  }
+}
+
+void parallelForOwned(int count, const std::function<void(int index)> &job) {
+  if (count <= 0)
+    return;
+  const int threads = threadCount();
+  if (threads == 1) {
+    for (int i = 0; i < count; i++)
+      job(i);
+    return;
+  }
+  pool.start();
+
+  std::function<void(int, int)> range = [&](int begin, int end) {
+    for (int i = begin; i < end; i++)
+      job(i);
+  };
+  Batch batch;
+  batch.job = &range;
+  // 先算好任务数, 任务入队后可能立即被执行
+  int tasks = 0;
+  for (int w = 0; w < threads; w++)
+    if ((int64_t)count * w / threads != (int64_t)count * (w + 1) / threads)
+      tasks++;
+  batch.remaining = tasks;
+  for (int w = 0; w < threads; w++) {
+    int first = (int)((int64_t)count * w / threads);
+    int last = (int)((int64_t)count * (w + 1) / threads);
+    if (first == last)
+      continue;
+    auto &queue = *pool.queues[w];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.owned.push_back({&batch, first, last});
+  }
+  {
+    std::lock_guard<std::mutex> lock(pool.sleepMutex);
+    for (int w = 0; w < threads; w++)
+      if ((int64_t)count * w / threads != (int64_t)count * (w + 1) / threads)
+        pool.queues[w]->ownedPending++;
+  }
+  pool.wake.notify_all();
+
+  const int self = currentWorker;
+  while (batch.remaining.load(std::memory_order_acquire) > 0) {
+    Task task;
+    if (take(self, task))
+      run(task);
+    else
+      std::this_thread::yield();
+  }
+}
+} // namespace CppGL::Jobs
@@ -0,0 +1,92 @@
+#include <CppGL/mapped-file.h>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace CppGL {
+namespace {
+// 只保存弱引用, 最后一个 buffer/texture 释放时映射随之解除并移除;
+// 不在进程退出时析构, 静态对象持有的映射可能在它之后才释放
+auto &openedFiles =
+    *new std::unordered_map<std::string, std::weak_ptr<MappedFile>>;
+} // namespace
+
+MappedFile::~MappedFile() {
+  if (data == nullptr)
+    return;
+  // 同一路径可能已被重新打开, 只移除已失效的项
+  auto search = openedFiles.find(path);
+  if (search != openedFiles.end() && search->second.expired())
+    openedFiles.erase(search);
+#ifdef _WIN32
+  delete[] data;
+#else
+  munmap(const_cast<uint8_t *>(data), size);
+#endif
+}
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string &path) {
+  auto search = openedFiles.find(path);
+  if (search != openedFiles.end()) {
+    if (auto file = search->second.lock())
+      return file;
+  }
+
+  auto file = std::make_shared<MappedFile>();
+#ifdef _WIN32
+  // 没有 mmap 时退化为整个读进内存
+  std::ifstream stream(path, std::ios::binary | std::ios::ate);
+  if (!stream)
+    return nullptr;
+  file->size = (size_t)stream.tellg();
+  if (file->size == 0)
+    return nullptr;
+  auto bytes = new uint8_t[file->size];
+  stream.seekg(0);
+  stream.read((char *)bytes, file->size);
+  file->data = bytes;
+#else
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return nullptr;
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    close(fd);
+    return nullptr;
+  }
+  void *addr = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // 映射建立后 fd 就不再需要了
+  close(fd);
+  if (addr == MAP_FAILED)
+    return nullptr;
+  file->data = static_cast<const uint8_t *>(addr);
+  file->size = info.st_size;
+#endif
+
+  file->path = path;
+  openedFiles[path] = file;
+  return file;
+}
+
+void MappedFile::advise(size_t offset, size_t length, FileAdvice advice) const {
+#ifndef _WIN32
+  int flag = MADV_NORMAL;
+  if (advice == FileAdvice::SEQUENTIAL)
+    flag = MADV_SEQUENTIAL;
+  if (advice == FileAdvice::RANDOM)
+    flag = MADV_RANDOM;
+
+  // madvise 要求起始地址按页对齐
+  size_t pageSize = sysconf(_SC_PAGESIZE);
+  size_t begin = offset / pageSize * pageSize;
+  madvise(const_cast<uint8_t *>(data) + begin, offset + length - begin, flag);
+#endif
+}
+} // namespace CppGL
@@ -0,0 +1,211 @@
+#include <CppGL/perf-counter.h>
+
+#ifdef __linux__
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <mutex>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+#endif
+
+namespace CppGL {
+PerfCounterValues &PerfCounterValues::operator+=(const PerfCounterValues &other) {
+  cycles += other.cycles;
+  instructions += other.instructions;
+  l1dMisses += other.l1dMisses;
+  llcMisses += other.llcMisses;
+  branchMisses += other.branchMisses;
+  return *this;
+}
+
+#ifdef __linux__
+namespace Perf {
+namespace {
+const int COUNTER_COUNT = 5;
+
+struct CounterConfig {
+  uint32_t type;
+  uint64_t config;
+};
+// 顺序与 PerfCounterValues 的字段一致
+const CounterConfig COUNTER_CONFIGS[COUNTER_COUNT] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                             PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                             PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+/**
+ * @brief 一个线程的计数器组, cycles 为 group leader, 其他计数器打开失败时
+ * 该项一直为0; 切换阶段时读一次整组, 差值计入切换前的阶段
+ */
+struct ThreadCounters {
+  int fds[COUNTER_COUNT] = {-1, -1, -1, -1, -1};
+  // 组内按打开顺序读出, slots 记录每个读数对应的计数器
+  int slots[COUNTER_COUNT];
+  int opened = 0;
+  bool failed = false;
+  PerfStage current = PerfStage::NONE;
+  uint64_t last[COUNTER_COUNT] = {};
+  PerfFrame frame;
+
+  ThreadCounters();
+  ~ThreadCounters();
+  bool open();
+  void read(uint64_t *values);
+  void switchTo(PerfStage stage);
+};
+
+std::atomic<bool> enabledFlag{false};
+std::mutex registryMutex;
+std::vector<ThreadCounters *> liveCounters;
+// 已退出线程未被 endFrame 取走的计数
+PerfFrame retiredFrame;
+
+long perfEventOpen(perf_event_attr *attr, int groupFd) {
+  // pid 为0, cpu 为-1: 只统计调用线程, 不限 cpu
+  return syscall(__NR_perf_event_open, attr, 0, -1, groupFd, 0);
+}
+
+void addFrame(PerfFrame &dst, const PerfFrame &src) {
+  for (int i = 0; i < (int)PerfStage::COUNT; i++)
+    dst.stages[i] += src.stages[i];
+}
+
+ThreadCounters::ThreadCounters() {
+  std::lock_guard<std::mutex> lock(registryMutex);
+  liveCounters.push_back(this);
+}
+
+ThreadCounters::~ThreadCounters() {
+  std::lock_guard<std::mutex> lock(registryMutex);
+  addFrame(retiredFrame, frame);
+  liveCounters.erase(
+      std::find(liveCounters.begin(), liveCounters.end(), this));
+  for (int fd : fds)
+    if (fd >= 0)
+      close(fd);
+}
+
+bool ThreadCounters::open() {
+  for (int i = 0; i < COUNTER_COUNT; i++) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = COUNTER_CONFIGS[i].type;
+    attr.config = COUNTER_CONFIGS[i].config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.disabled = i == 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    int fd = (int)perfEventOpen(&attr, i == 0 ? -1 : fds[0]);
+    if (fd < 0 && i == 0)
+      return false;
+    if (fd < 0)
+      continue;
+    fds[i] = fd;
+    slots[opened++] = i;
+  }
+  ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  return true;
+}
+
+void ThreadCounters::read(uint64_t *values) {
+  // PERF_FORMAT_GROUP: 先是计数器个数, 然后按打开顺序的值
+  uint64_t buffer[1 + COUNTER_COUNT] = {};
+  if (::read(fds[0], buffer, sizeof(uint64_t) * (1 + opened)) <= 0)
+    return;
+  for (int i = 0; i < opened; i++)
+    values[slots[i]] = buffer[1 + i];
+}
+
+void ThreadCounters::switchTo(PerfStage stage) {
+  if (stage == current || failed)
+    return;
+  if (fds[0] < 0 && !open()) {
+    failed = true;
+    return;
+  }
+
+  uint64_t now[COUNTER_COUNT];
+  memcpy(now, last, sizeof(now));
+  read(now);
+  if (current != PerfStage::NONE) {
+    auto &values = frame.stages[(int)current];
+    values.cycles += now[0] - last[0];
+    values.instructions += now[1] - last[1];
+    values.l1dMisses += now[2] - last[2];
+    values.llcMisses += now[3] - last[3];
+    values.branchMisses += now[4] - last[4];
+  }
+  memcpy(last, now, sizeof(now));
+  current = stage;
+}
+
+ThreadCounters &threadCounters() {
+  thread_local ThreadCounters counters;
+  return counters;
+}
+} // namespace
+
+bool enable() {
+  // 先在调用线程上试打开, 不可用时不进入计数模式
+  auto &counters = threadCounters();
+  if (counters.fds[0] < 0 && (counters.failed || !counters.open())) {
+    counters.failed = true;
+    return false;
+  }
+  enabledFlag = true;
+  return true;
+}
+
+void disable() { enabledFlag = false; }
+
+bool enabled() { return enabledFlag; }
+
+PerfFrame endFrame() {
+  std::lock_guard<std::mutex> lock(registryMutex);
+  PerfFrame out = retiredFrame;
+  retiredFrame = {};
+  for (auto counters : liveCounters) {
+    addFrame(out, counters->frame);
+    counters->frame = {};
+  }
+  return out;
+}
+
+StageScope::StageScope(PerfStage stage) {
+  if (!enabledFlag)
+    return;
+  auto &counters = threadCounters();
+  previous = counters.current;
+  active = true;
+  counters.switchTo(stage);
+}
+
+void StageScope::end() {
+  if (!active)
+    return;
+  active = false;
+  threadCounters().switchTo(previous);
+}
+} // namespace Perf
+#else
+namespace Perf {
+bool enable() { return false; }
+void disable() {}
+bool enabled() { return false; }
+PerfFrame endFrame() { return {}; }
+StageScope::StageScope(PerfStage) {}
+void StageScope::end() {}
+} // namespace Perf
+#endif
+} // namespace CppGL
@@ -0,0 +1,76 @@
+#include <CppGL/query.h>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace CppGL {
+namespace {
+std::mutex registryMutex;
+std::vector<const PipelineStatistics *> liveStatistics;
+// 已退出线程的计数
+PipelineStatistics retiredStatistics;
+
+/**
+ * @brief 线程第一次计数时登记, 退出时把计数并入 retiredStatistics
+ */
+struct ThreadStatistics {
+  PipelineStatistics counters;
+
+  ThreadStatistics() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    liveStatistics.push_back(&counters);
+  }
+  ~ThreadStatistics() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    retiredStatistics += counters;
+    liveStatistics.erase(
+        std::find(liveStatistics.begin(), liveStatistics.end(), &counters));
+  }
+};
+} // namespace
+
+PipelineStatistics &
+PipelineStatistics::operator+=(const PipelineStatistics &other) {
+  verticesShaded += other.verticesShaded;
+  primitivesSubmitted += other.primitivesSubmitted;
+  primitivesClipped += other.primitivesClipped;
+  primitivesCulled += other.primitivesCulled;
+  pixelsTested += other.pixelsTested;
+  pixelsDepthRejected += other.pixelsDepthRejected;
+  pixelsDiscarded += other.pixelsDiscarded;
+  pixelsWritten += other.pixelsWritten;
+  fragmentShaderInvocations += other.fragmentShaderInvocations;
+  return *this;
+}
+
+PipelineStatistics
+PipelineStatistics::operator-(const PipelineStatistics &other) const {
+  PipelineStatistics out;
+  out.verticesShaded = verticesShaded - other.verticesShaded;
+  out.primitivesSubmitted = primitivesSubmitted - other.primitivesSubmitted;
+  out.primitivesClipped = primitivesClipped - other.primitivesClipped;
+  out.primitivesCulled = primitivesCulled - other.primitivesCulled;
+  out.pixelsTested = pixelsTested - other.pixelsTested;
+  out.pixelsDepthRejected = pixelsDepthRejected - other.pixelsDepthRejected;
+  out.pixelsDiscarded = pixelsDiscarded - other.pixelsDiscarded;
+  out.pixelsWritten = pixelsWritten - other.pixelsWritten;
+  out.fragmentShaderInvocations =
+      fragmentShaderInvocations - other.fragmentShaderInvocations;
+  return out;
+}
+
+namespace Helper {
+PipelineStatistics &threadStatistics() {
+  thread_local ThreadStatistics statistics;
+  return statistics.counters;
+}
+
+PipelineStatistics mergeStatistics() {
+  std::lock_guard<std::mutex> lock(registryMutex);
+  PipelineStatistics out = retiredStatistics;
+  for (auto counters : liveStatistics)
+    out += *counters;
+  return out;
+}
+} // namespace Helper
+} // namespace CppGL
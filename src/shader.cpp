@@ -2,6 +2,7 @@
 #include "CppGL/math.h"
 #include <CppGL/global-state.h>
 #include <CppGL/shader.h>
+#include <algorithm>
 
 namespace CppGL {
 vec4 ShaderSource::texture2D(sample2D textureUint, vec2 uv) {
@@ -21,8 +22,10 @@ vec4 ShaderSource::texture2D(sample2D textureUint, vec2 uv) {
       if (texture->TEXTURE_WRAP_T == GL_REPEAT && uv.y < 0 || uv.y > 1)
         uv.y = std::abs(uv.y - (float)(int32_t)(uv.y));
 
-      uint32_t x = uv.x * mip->width;
-      uint32_t y = (1 - uv.y) * mip->height;
+      // uv 为 0 或 1 时会落在边界外一个texel
+      uint32_t x = std::min((uint32_t)(uv.x * mip->width), mip->width - 1u);
+      uint32_t y =
+          std::min((uint32_t)((1 - uv.y) * mip->height), mip->height - 1u);
 
       // std::cout << x << "," << y << std::endl;
 
@@ -0,0 +1,130 @@
+#include <CppGL/trace.h>
+
+#ifdef CPPGL_ENABLE_TRACE
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+namespace CppGL::Trace {
+namespace {
+struct Event {
+  const char *category;
+  const char *name;
+  uint64_t begin;
+  uint64_t end;
+};
+
+/**
+ * @brief 每个线程只追加自己的 buffer, 记录时不需要加锁
+ */
+struct ThreadEvents {
+  int id;
+  std::vector<Event> events;
+};
+
+std::atomic<bool> recording{false};
+std::mutex registryMutex;
+std::vector<ThreadEvents *> liveThreads;
+// 已退出线程的记录, 写文件时一并输出
+std::vector<ThreadEvents> retiredThreads;
+int nextThreadId = 0;
+
+struct ThreadRegistration {
+  ThreadEvents buffer;
+
+  ThreadRegistration() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffer.id = nextThreadId++;
+    liveThreads.push_back(&buffer);
+  }
+  ~ThreadRegistration() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    if (!buffer.events.empty())
+      retiredThreads.push_back(std::move(buffer));
+    liveThreads.erase(
+        std::find(liveThreads.begin(), liveThreads.end(), &buffer));
+  }
+};
+
+ThreadEvents &threadEvents() {
+  thread_local ThreadRegistration registration;
+  return registration.buffer;
+}
+
+inline uint64_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void writeThread(FILE *file, const ThreadEvents &thread, bool &first) {
+  for (auto &event : thread.events) {
+    // trace_event 的时间单位为微秒
+    fprintf(file,
+            "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,"
+            "\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+            first ? "" : ",", event.name, event.category, event.begin / 1e3,
+            (event.end - event.begin) / 1e3, thread.id);
+    first = false;
+  }
+  if (!thread.events.empty()) {
+    fprintf(file,
+            "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+            "\"args\":{\"name\":\"thread %d\"}}",
+            first ? "" : ",", thread.id, thread.id);
+    first = false;
+  }
+}
+} // namespace
+
+Scope::Scope(const char *category, const char *name)
+    : category(category), name(name), ended(!recording) {
+  if (!ended)
+    begin = now();
+}
+
+void Scope::end() {
+  if (ended)
+    return;
+  ended = true;
+  threadEvents().events.push_back({category, name, begin, now()});
+}
+
+void start() {
+  std::lock_guard<std::mutex> lock(registryMutex);
+  for (auto thread : liveThreads)
+    thread->events.clear();
+  retiredThreads.clear();
+  recording = true;
+}
+
+bool stop(const char *path) {
+  recording = false;
+  std::lock_guard<std::mutex> lock(registryMutex);
+  FILE *file = fopen(path, "w");
+  if (file == nullptr)
+    return false;
+  fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+  bool first = true;
+  for (auto thread : liveThreads)
+    writeThread(file, *thread, first);
+  for (auto &thread : retiredThreads)
+    writeThread(file, thread, first);
+  fprintf(file, "\n]}\n");
+  fclose(file);
+
+  for (auto thread : liveThreads)
+    thread->events.clear();
+  retiredThreads.clear();
+  return true;
+}
+} // namespace CppGL::Trace
+#else
+namespace CppGL::Trace {
+void start() {}
+bool stop(const char *) { return false; }
+} // namespace CppGL::Trace
+#endif
@@ -0,0 +1,195 @@
+#include <CppGL/vertex-array.h>
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+namespace CppGL {
+namespace {
+template <int Type> struct ComponentOf;
+template <> struct ComponentOf<GL_FLOAT> {
+  using type = float;
+  static constexpr float max = 1;
+};
+template <> struct ComponentOf<GL_UNSIGNED_BYTE> {
+  using type = uint8_t;
+  static constexpr float max = 255;
+};
+template <> struct ComponentOf<GL_BYTE> {
+  using type = int8_t;
+  static constexpr float max = 127;
+};
+template <> struct ComponentOf<GL_UNSIGNED_SHORT> {
+  using type = uint16_t;
+  static constexpr float max = 65535;
+};
+template <> struct ComponentOf<GL_SHORT> {
+  using type = int16_t;
+  static constexpr float max = 32767;
+};
+template <> struct ComponentOf<GL_HALF_FLOAT> {
+  using type = uint16_t;
+  static constexpr float max = 1;
+};
+
+inline float asFloat(uint32_t bits) {
+  float f;
+  memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+inline uint32_t asUint(float f) {
+  uint32_t bits;
+  memcpy(&bits, &f, sizeof(bits));
+  return bits;
+}
+
+/**
+ * @brief half 转 float, 指数/尾数整体左移后乘 2^112 修正指数偏移,
+ * 非规格化数也能直接得到正确结果, 只有 inf/nan 需要单独处理
+ */
+inline float halfToFloat(uint16_t h) {
+  uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+  uint32_t exponentMantissa = h & 0x7fff;
+  float magic = asFloat(0x77800000); // 2^112
+  uint32_t bits = asUint(asFloat(exponentMantissa << 13) * magic);
+  if (exponentMantissa >= 0x7c00)
+    bits = 0x7f800000 | (exponentMantissa & 0x3ff) << 13;
+  return asFloat(bits | sign);
+}
+
+template <int Type, bool Normalized, int Size>
+void fetchAttribute(const uint8_t *src, float *dst) {
+  using T = typename ComponentOf<Type>::type;
+  if constexpr (Type == GL_FLOAT) {
+    memcpy(dst, src, sizeof(float) * Size);
+  } else {
+    T components[Size];
+    memcpy(components, src, sizeof(T) * Size);
+    for (int i = 0; i < Size; i++) {
+      if constexpr (Type == GL_HALF_FLOAT)
+        dst[i] = halfToFloat(components[i]);
+      else if constexpr (!Normalized)
+        dst[i] = (float)components[i];
+      else if constexpr (std::is_signed_v<T>)
+        // 有符号归一化 c / (2^(b-1) - 1), 最小值截断到 -1
+        dst[i] = std::max(components[i] / ComponentOf<Type>::max, -1.f);
+      else
+        dst[i] = components[i] / ComponentOf<Type>::max;
+    }
+  }
+}
+
+/**
+ * @brief 2_10_10_10_REV 打包格式, x 在最低位, w 占最高2位, 只支持 size 为4
+ */
+template <bool Signed, bool Normalized>
+void fetchPackedAttribute(const uint8_t *src, float *dst) {
+  uint32_t packed;
+  memcpy(&packed, src, sizeof(packed));
+  const int shifts[] = {0, 10, 20, 30};
+  const int bits[] = {10, 10, 10, 2};
+  for (int i = 0; i < 4; i++) {
+    int max = (1 << (Signed ? bits[i] - 1 : bits[i])) - 1;
+    int value;
+    if constexpr (Signed)
+      // 先左移到最高位再算术右移完成符号扩展
+      value = (int32_t)(packed << (32 - shifts[i] - bits[i])) >>
+              (32 - bits[i]);
+    else
+      value = (packed >> shifts[i]) & ((1 << bits[i]) - 1);
+
+    if constexpr (!Normalized)
+      dst[i] = (float)value;
+    else if constexpr (Signed)
+      dst[i] = std::max((float)value / max, -1.f);
+    else
+      dst[i] = (float)value / max;
+  }
+}
+
+template <int Type, bool Normalized>
+AttributeFetcher getFetcher(int size) {
+  switch (size) {
+  case 1:
+    return &fetchAttribute<Type, Normalized, 1>;
+  case 2:
+    return &fetchAttribute<Type, Normalized, 2>;
+  case 3:
+    return &fetchAttribute<Type, Normalized, 3>;
+  case 4:
+    return &fetchAttribute<Type, Normalized, 4>;
+  }
+  return nullptr;
+}
+
+template <int Type> AttributeFetcher getFetcher(int size, bool normalized) {
+  return normalized ? getFetcher<Type, true>(size)
+                    : getFetcher<Type, false>(size);
+}
+
+template <bool Signed>
+AttributeFetcher getPackedFetcher(int size, bool normalized) {
+  if (size != 4)
+    return nullptr;
+  return normalized ? &fetchPackedAttribute<Signed, true>
+                    : &fetchPackedAttribute<Signed, false>;
+}
+} // namespace
+
+AttributeInfo &VertexArray::attribute(int location) {
+  if (attributes.size() < location + 1)
+    attributes.resize(location + 1);
+  dirty = true;
+  return attributes[location];
+}
+
+void VertexArray::compile() {
+  if (!dirty)
+    return;
+
+  for (auto &info : attributes) {
+    int elementLen = 0;
+    info.fetch = nullptr;
+
+    switch (info.type) {
+    case GL_FLOAT:
+      elementLen = info.size * sizeof(float);
+      // float 不存在归一化
+      info.fetch = getFetcher<GL_FLOAT, false>(info.size);
+      break;
+    case GL_HALF_FLOAT:
+      elementLen = info.size * sizeof(uint16_t);
+      info.fetch = getFetcher<GL_HALF_FLOAT, false>(info.size);
+      break;
+    case GL_UNSIGNED_BYTE:
+      elementLen = info.size * sizeof(uint8_t);
+      info.fetch = getFetcher<GL_UNSIGNED_BYTE>(info.size, info.normalized);
+      break;
+    case GL_BYTE:
+      elementLen = info.size * sizeof(int8_t);
+      info.fetch = getFetcher<GL_BYTE>(info.size, info.normalized);
+      break;
+    case GL_UNSIGNED_SHORT:
+      elementLen = info.size * sizeof(uint16_t);
+      info.fetch = getFetcher<GL_UNSIGNED_SHORT>(info.size, info.normalized);
+      break;
+    case GL_SHORT:
+      elementLen = info.size * sizeof(int16_t);
+      info.fetch = getFetcher<GL_SHORT>(info.size, info.normalized);
+      break;
+    case GL_INT_2_10_10_10_REV:
+      elementLen = sizeof(uint32_t);
+      info.fetch = getPackedFetcher<true>(info.size, info.normalized);
+      break;
+    case GL_UNSIGNED_INT_2_10_10_10_REV:
+      elementLen = sizeof(uint32_t);
+      info.fetch = getPackedFetcher<false>(info.size, info.normalized);
+      break;
+    }
+
+    info.byteStride = info.stride;
+    if (info.byteStride == 0)
+      info.byteStride = elementLen;
+  }
+  dirty = false;
+}
+} // namespace CppGL